@@ -0,0 +1,490 @@
+/*
+ * Copyright (C) 2024 Christian Berger, Ionel Pop, Adrian Hassa,
+ *                        Teodora Portase, Vasilena Karaivanova
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Include the single-file, header-only middleware libcluon to attach to the shared memory
+#include "cluon-complete.hpp"
+
+// Include the image processing header files from OpenCV
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <tuple>
+#include <vector>
+
+// Include the stages that are benchmarked
+#include "BlobDetector.hpp"
+#include "ConeBranch.hpp"
+#include "ConeColorStage.hpp"
+#include "ImageDenoiser.hpp"
+#include "WorkerPool.hpp"
+
+// Same HSV bounds as the defaults in main.cpp
+static const cv::Scalar blueLow = cv::Scalar(109, 68, 42);
+static const cv::Scalar blueHigh = cv::Scalar(135, 250, 120);
+static const cv::Scalar yellowLow = cv::Scalar(11, 20, 128);
+static const cv::Scalar yellowHigh = cv::Scalar(54, 198, 232);
+
+// Row where the region of interest starts, same as in main.cpp
+static const int ROI_TOP = 230;
+
+// Same threshold and maximum value as the defaults in main.cpp
+static const int THRESHOLD = 30;
+static const int MAX_VALUE = 255;
+
+// Per-frame latency of one benchmark case in microseconds
+struct LatencySummary
+{
+    double mean;
+    double median;
+    double p99;
+};
+
+static LatencySummary summarize(std::vector<double> samples)
+{
+    LatencySummary summary{0, 0, 0};
+    if (samples.empty())
+    {
+        return summary;
+    }
+
+    std::sort(samples.begin(), samples.end());
+    for (double sample : samples)
+    {
+        summary.mean += sample;
+    }
+    summary.mean /= static_cast<double>(samples.size());
+    summary.median = samples[samples.size() / 2];
+    summary.p99 = samples[std::min(samples.size() - 1, (samples.size() * 99) / 100)];
+    return summary;
+}
+
+// Run a stage over all captured regions of interest and print its per-frame latency
+static LatencySummary runCase(const std::string &name, const std::vector<cv::Mat> &rois, int repeat, const std::function<void(const cv::Mat &)> &stage)
+{
+    std::vector<double> samples;
+    samples.reserve(rois.size() * static_cast<size_t>(repeat));
+
+    // Warm up once so that the buffers of the stage are allocated
+    stage(rois.front());
+
+    for (int r = 0; r < repeat; r++)
+    {
+        for (const cv::Mat &roi : rois)
+        {
+            auto start = std::chrono::steady_clock::now();
+            stage(roi);
+            auto end = std::chrono::steady_clock::now();
+            samples.push_back(std::chrono::duration<double, std::micro>(end - start).count());
+        }
+    }
+
+    LatencySummary summary = summarize(samples);
+    std::cout << name << ": mean " << summary.mean << " us, median " << summary.median << " us, p99 " << summary.p99 << " us per frame" << std::endl;
+    return summary;
+}
+
+int32_t main(int32_t argc, char **argv)
+{
+    int32_t retCode{1};
+
+    auto commandlineArguments = cluon::getCommandlineArguments(argc, argv);
+    if ((0 == commandlineArguments.count("name")) ||
+        (0 == commandlineArguments.count("width")) ||
+        (0 == commandlineArguments.count("height")))
+    {
+        std::cerr << argv[0] << " captures frames from a shared memory area and benchmarks the image processing stages on them." << std::endl;
+        std::cerr << "Usage:   " << argv[0] << " --name=<name of shared memory area> --width=<width> --height=<height> [--frames=<n>] [--repeat=<n>]" << std::endl;
+        std::cerr << "         --name:   name of the shared memory area to attach" << std::endl;
+        std::cerr << "         --width:  width of the frame" << std::endl;
+        std::cerr << "         --height: height of the frame" << std::endl;
+        std::cerr << "         --frames: number of frames to capture before benchmarking (default: 300)" << std::endl;
+        std::cerr << "         --repeat: how many times every captured frame is processed (default: 5)" << std::endl;
+        std::cerr << "Example: " << argv[0] << " --name=img --width=640 --height=480 --frames=300" << std::endl;
+        std::cerr << "         (replay RECORDING1.rec into the shared memory with the h264 service from recordings/docker-compose.yaml)" << std::endl;
+    }
+    else
+    {
+        const std::string NAME{commandlineArguments["name"]};
+        const uint32_t WIDTH{static_cast<uint32_t>(std::stoi(commandlineArguments["width"]))};
+        const uint32_t HEIGHT{static_cast<uint32_t>(std::stoi(commandlineArguments["height"]))};
+        const size_t FRAMES{(commandlineArguments.count("frames") != 0) ? static_cast<size_t>(std::stoi(commandlineArguments["frames"])) : 300};
+        const int REPEAT{(commandlineArguments.count("repeat") != 0) ? std::stoi(commandlineArguments["repeat"]) : 5};
+
+        std::unique_ptr<cluon::SharedMemory> sharedMemory{new cluon::SharedMemory{NAME}};
+        if (sharedMemory && sharedMemory->valid())
+        {
+            std::clog << argv[0] << ": Attached to shared memory '" << sharedMemory->name() << " (" << sharedMemory->size() << " bytes)." << std::endl;
+
+            // Capture the frames first so that every case is measured on exactly the same input
+            std::vector<cv::Mat> rois;
+            int64_t previousTimeStamp = 0;
+            while (rois.size() < FRAMES)
+            {
+                sharedMemory->wait();
+
+                cv::Mat frame;
+                int64_t timeStamp = 0;
+                sharedMemory->lock();
+                {
+                    cv::Mat wrapped(HEIGHT, WIDTH, CV_8UC4, sharedMemory->data());
+                    frame = wrapped.clone();
+                    timeStamp = cluon::time::toMicroseconds(sharedMemory->getTimeStamp().second);
+                }
+                sharedMemory->unlock();
+
+                // The replay is over once the same frame is delivered again
+                if (timeStamp == previousTimeStamp)
+                {
+                    break;
+                }
+                previousTimeStamp = timeStamp;
+
+                rois.push_back(frame(cv::Rect(0, ROI_TOP, frame.cols, frame.rows - ROI_TOP)));
+            }
+            std::clog << argv[0] << ": Captured " << rois.size() << " frames." << std::endl;
+            if (rois.empty())
+            {
+                return retCode;
+            }
+
+            // Color classification: HSV conversion per color (previous main.cpp) versus one shared conversion
+            cv::Mat blueImage, yellowImage, maskBlue, maskYellow;
+            LatencySummary twice = runCase("hsv-per-color", rois, REPEAT, [&](const cv::Mat &roi) {
+                cv::cvtColor(roi, blueImage, cv::COLOR_BGR2HSV);
+                cv::cvtColor(roi, yellowImage, cv::COLOR_BGR2HSV);
+                cv::inRange(blueImage, blueLow, blueHigh, maskBlue);
+                cv::inRange(yellowImage, yellowLow, yellowHigh, maskYellow);
+            });
+
+            ConeColorStage coneColorStage{ConeColorStage::Mode::OPENCV};
+            coneColorStage.setBlueRange(blueLow, blueHigh);
+            coneColorStage.setYellowRange(yellowLow, yellowHigh);
+            LatencySummary shared = runCase("hsv-shared", rois, REPEAT, [&](const cv::Mat &roi) {
+                coneColorStage.process(roi, maskBlue, maskYellow);
+            });
+
+            std::cout << "hsv-shared saves " << (twice.mean - shared.mean) << " us per frame on average" << std::endl;
+
+            // Fused BGR to mask kernel for every instruction set this CPU supports
+            ConeColorStage fusedStage{ConeColorStage::Mode::FUSED};
+            fusedStage.setBlueRange(blueLow, blueHigh);
+            fusedStage.setYellowRange(yellowLow, yellowHigh);
+            HsvRange blueRange{{109, 68, 42}, {135, 250, 120}};
+            HsvRange yellowRange{{11, 20, 128}, {54, 198, 232}};
+            const ConeColorKernel::Isa isas[] = {ConeColorKernel::Isa::SCALAR, ConeColorKernel::Isa::SSE41, ConeColorKernel::Isa::AVX2};
+            for (ConeColorKernel::Isa isa : isas)
+            {
+                if (!ConeColorKernel::isSupported(isa))
+                {
+                    continue;
+                }
+                runCase(std::string("fused-") + ConeColorKernel::name(isa), rois, REPEAT, [&](const cv::Mat &roi) {
+                    maskBlue.create(roi.size(), CV_8U);
+                    maskYellow.create(roi.size(), CV_8U);
+                    for (int y = 0; y < roi.rows; y++)
+                    {
+                        ConeColorKernel::classify(roi.ptr<uint8_t>(y), roi.channels(), static_cast<size_t>(roi.cols), blueRange, yellowRange,
+                                                  maskBlue.ptr<uint8_t>(y), maskYellow.ptr<uint8_t>(y));
+                    }
+                });
+            }
+
+            // Lookup table: building it is paid once per trackbar change, the lookups once per frame
+            ConeColorStage lutStage{ConeColorStage::Mode::LUT};
+            lutStage.setBlueRange(blueLow, blueHigh);
+            lutStage.setYellowRange(yellowLow, yellowHigh);
+            auto buildStart = std::chrono::steady_clock::now();
+            lutStage.process(rois.front(), maskBlue, maskYellow);
+            auto buildEnd = std::chrono::steady_clock::now();
+            std::cout << "lut: build " << std::chrono::duration<double, std::milli>(buildEnd - buildStart).count() << " ms, "
+                      << lutStage.getColorLut().memoryFootprint() / 1024 << " KiB" << std::endl;
+            LatencySummary lut = runCase("lut", rois, REPEAT, [&](const cv::Mat &roi) {
+                lutStage.process(roi, maskBlue, maskYellow);
+            });
+            const double roiPixels = static_cast<double>(rois.front().total());
+            std::cout << "throughput: cvtColor + inRange " << roiPixels / shared.mean << " Mpx/s, lut " << roiPixels / lut.mean << " Mpx/s" << std::endl;
+
+            // The fused kernel and the lookup table have to produce exactly the same masks as cvtColor + inRange
+            size_t mismatchedPixels = 0;
+            cv::Mat otherBlue, otherYellow, difference;
+            for (const cv::Mat &roi : rois)
+            {
+                coneColorStage.process(roi, maskBlue, maskYellow);
+                for (ConeColorStage *stage : {&fusedStage, &lutStage})
+                {
+                    stage->process(roi, otherBlue, otherYellow);
+                    cv::compare(maskBlue, otherBlue, difference, cv::CMP_NE);
+                    mismatchedPixels += static_cast<size_t>(cv::countNonZero(difference));
+                    cv::compare(maskYellow, otherYellow, difference, cv::CMP_NE);
+                    mismatchedPixels += static_cast<size_t>(cv::countNonZero(difference));
+                }
+            }
+            std::cout << "fused and lut masks differ from cvtColor + inRange in " << mismatchedPixels << " pixels" << std::endl;
+            if (mismatchedPixels != 0)
+            {
+                return retCode;
+            }
+
+            // Denoising: one OpenCV function per step versus the fused pass over strips of rows, on the blue masks
+            std::vector<cv::Mat> blueMasks, yellowMasks;
+            for (const cv::Mat &roi : rois)
+            {
+                coneColorStage.process(roi, maskBlue, maskYellow);
+                blueMasks.push_back(maskBlue.clone());
+                yellowMasks.push_back(maskYellow.clone());
+            }
+            ImageDenoiser opencvDenoiser{ImageDenoiser::Mode::OPENCV};
+            ImageDenoiser fusedDenoiser{ImageDenoiser::Mode::FUSED};
+            for (ImageDenoiser *denoiser : {&opencvDenoiser, &fusedDenoiser})
+            {
+                denoiser->configure(rois.front().size(), rois.front().type(), 5, ImageDenoiser::carRegion(rois.front().size()));
+            }
+
+            cv::Mat processed, otherProcessed;
+            size_t frame = 0;
+            LatencySummary opencvDenoise = runCase("denoise-opencv", rois, REPEAT, [&](const cv::Mat &roi) {
+                opencvDenoiser.denoiseImage(roi, blueMasks[frame++ % blueMasks.size()], processed, THRESHOLD, MAX_VALUE);
+            });
+            frame = 0;
+            LatencySummary fusedDenoise = runCase("denoise-fused", rois, REPEAT, [&](const cv::Mat &roi) {
+                fusedDenoiser.denoiseImage(roi, blueMasks[frame++ % blueMasks.size()], processed, THRESHOLD, MAX_VALUE);
+            });
+            std::cout << "denoise-fused saves " << (opencvDenoise.mean - fusedDenoise.mean) << " us per frame and mask on average" << std::endl;
+
+            // The fused kernel reproduces the fixed point arithmetic of OpenCV, so the tolerance is 0 pixels
+            mismatchedPixels = 0;
+            for (size_t i = 0; i < rois.size(); i++)
+            {
+                opencvDenoiser.denoiseImage(rois[i], blueMasks[i], processed, THRESHOLD, MAX_VALUE);
+                fusedDenoiser.denoiseImage(rois[i], blueMasks[i], otherProcessed, THRESHOLD, MAX_VALUE);
+                cv::compare(processed, otherProcessed, difference, cv::CMP_NE);
+                mismatchedPixels += static_cast<size_t>(cv::countNonZero(difference));
+            }
+            std::cout << "denoise-fused differs from denoise-opencv in " << mismatchedPixels << " pixels" << std::endl;
+            if (mismatchedPixels != 0)
+            {
+                return retCode;
+            }
+
+            // The mask domain mode keeps even mask values too, so its difference is only reported
+            ImageDenoiser maskDenoiser{ImageDenoiser::Mode::MASK};
+            maskDenoiser.configure(rois.front().size(), rois.front().type(), 5, ImageDenoiser::carRegion(rois.front().size()));
+            frame = 0;
+            runCase("denoise-mask", rois, REPEAT, [&](const cv::Mat &roi) {
+                maskDenoiser.denoiseImage(roi, blueMasks[frame++ % blueMasks.size()], processed, THRESHOLD, MAX_VALUE);
+            });
+            size_t opencvPixels = 0;
+            size_t maskPixels = 0;
+            for (size_t i = 0; i < rois.size(); i++)
+            {
+                opencvDenoiser.denoiseImage(rois[i], blueMasks[i], processed, THRESHOLD, MAX_VALUE);
+                opencvPixels += static_cast<size_t>(cv::countNonZero(processed));
+                maskDenoiser.denoiseImage(rois[i], blueMasks[i], processed, THRESHOLD, MAX_VALUE);
+                maskPixels += static_cast<size_t>(cv::countNonZero(processed));
+            }
+            std::cout << "denoise-mask keeps " << maskPixels << " pixels, denoise-opencv " << opencvPixels << " pixels" << std::endl;
+
+            // Blob detection: cv::findContours versus the bit-packed mask, on the denoised blue masks
+            std::vector<cv::Mat> processedMasks;
+            for (size_t i = 0; i < rois.size(); i++)
+            {
+                fusedDenoiser.denoiseImage(rois[i], blueMasks[i], processed, THRESHOLD, MAX_VALUE);
+                processedMasks.push_back(processed.clone());
+            }
+            BlobDetector contourDetector{BlobDetector::Mode::CONTOURS};
+            BlobDetector bitMaskDetector{BlobDetector::Mode::BITMASK};
+            BlobDetector labelDetector{BlobDetector::Mode::LABELS};
+            BlobDetector runDetector{BlobDetector::Mode::RUNS};
+            std::vector<cv::Rect> boxes, otherBoxes;
+            frame = 0;
+            LatencySummary contourBlobs = runCase("blobs-contours", rois, REPEAT, [&](const cv::Mat &) {
+                contourDetector.detect(processedMasks[frame++ % processedMasks.size()], boxes);
+            });
+            frame = 0;
+            LatencySummary bitMaskBlobs = runCase("blobs-bitmask", rois, REPEAT, [&](const cv::Mat &) {
+                bitMaskDetector.detect(processedMasks[frame++ % processedMasks.size()], boxes);
+            });
+            std::cout << "blobs-bitmask saves " << (contourBlobs.mean - bitMaskBlobs.mean) << " us per frame and mask on average" << std::endl;
+            frame = 0;
+            LatencySummary labelBlobs = runCase("blobs-labels", rois, REPEAT, [&](const cv::Mat &) {
+                labelDetector.detect(processedMasks[frame++ % processedMasks.size()], boxes);
+            });
+            std::cout << "blobs-labels saves " << (contourBlobs.mean - labelBlobs.mean) << " us per frame and mask on average" << std::endl;
+            frame = 0;
+            LatencySummary runBlobs = runCase("blobs-runs", rois, REPEAT, [&](const cv::Mat &) {
+                runDetector.detect(processedMasks[frame++ % processedMasks.size()], boxes);
+            });
+            std::cout << "blobs-runs saves " << (contourBlobs.mean - runBlobs.mean) << " us per frame and mask on average" << std::endl;
+
+            // The run-length detector pays per run, so report how sparse the masks are
+            size_t runCount = 0;
+            std::vector<MaskRun> runs;
+            for (const cv::Mat &mask : processedMasks)
+            {
+                for (int y = 0; y < mask.rows; y++)
+                {
+                    runs.clear();
+                    RunLengthLabeller::encodeRow(mask.ptr<uint8_t>(y), mask.cols, runs);
+                    runCount += runs.size();
+                }
+            }
+            std::cout << "blobs-runs: " << static_cast<double>(runCount) / static_cast<double>(processedMasks.size()) << " runs per mask on average" << std::endl;
+
+            // All detectors have to find the same bounding boxes, the order may differ
+            auto byPosition = [](const cv::Rect &a, const cv::Rect &b) {
+                return std::tie(a.y, a.x, a.height, a.width) < std::tie(b.y, b.x, b.height, b.width);
+            };
+            size_t mismatchedFrames = 0;
+            for (const cv::Mat &mask : processedMasks)
+            {
+                contourDetector.detect(mask, boxes);
+                std::sort(boxes.begin(), boxes.end(), byPosition);
+                for (BlobDetector *detector : {&bitMaskDetector, &labelDetector, &runDetector})
+                {
+                    detector->detect(mask, otherBoxes);
+                    std::sort(otherBoxes.begin(), otherBoxes.end(), byPosition);
+                    if (boxes != otherBoxes)
+                    {
+                        mismatchedFrames++;
+                    }
+                }
+            }
+            std::cout << "blobs-bitmask, blobs-labels and blobs-runs differ from blobs-contours in " << mismatchedFrames << " frames" << std::endl;
+            if (mismatchedFrames != 0)
+            {
+                return retCode;
+            }
+
+            // Branches: denoising, blob detection and distances of both colors one after the other versus on two threads
+            ImageDenoiser blueDenoiser{ImageDenoiser::Mode::FUSED};
+            ImageDenoiser yellowDenoiser{ImageDenoiser::Mode::FUSED};
+            for (ImageDenoiser *denoiser : {&blueDenoiser, &yellowDenoiser})
+            {
+                denoiser->configure(rois.front().size(), rois.front().type(), 5, ImageDenoiser::carRegion(rois.front().size()));
+            }
+            ConeBranch blueBranch{"blue branch", blueDenoiser, BlobDetector::Mode::RUNS};
+            ConeBranch yellowBranch{"yellow branch", yellowDenoiser, BlobDetector::Mode::RUNS};
+            const cv::Point imageCenter(rois.front().cols / 2, rois.front().rows + ROI_TOP);
+            LatencySummary branches[2];
+            for (size_t workers = 0; workers < 2; workers++)
+            {
+                WorkerPool pool{workers};
+                frame = 0;
+                branches[workers] = runCase((workers == 0) ? "branches-serial" : "branches-parallel", rois, REPEAT, [&](const cv::Mat &roi) {
+                    const size_t index = frame++ % rois.size();
+                    pool.run(2, [&](size_t branch) {
+                        if (branch == 0)
+                        {
+                            blueBranch.process(roi, blueMasks[index], processed, THRESHOLD, MAX_VALUE, ROI_TOP, imageCenter);
+                        }
+                        else
+                        {
+                            yellowBranch.process(roi, yellowMasks[index], otherProcessed, THRESHOLD, MAX_VALUE, ROI_TOP, imageCenter);
+                        }
+                    });
+                });
+                for (ConeBranch *branch : {&blueBranch, &yellowBranch})
+                {
+                    std::cout << "  ";
+                    branch->getDurationStats().print(std::cout);
+                    branch->getDurationStats().reset();
+                    std::cout << std::endl;
+                }
+            }
+            std::cout << "branches-parallel saves " << (branches[0].mean - branches[1].mean) << " us per frame on average" << std::endl;
+
+            // Scaling: color classification and both branches split into one strip of rows per thread, as with --threads
+            std::vector<cv::Mat> referenceBlue, referenceYellow;
+            double singleThread = 0;
+            mismatchedPixels = 0;
+            for (size_t threads = 1; threads <= 16; threads++)
+            {
+                WorkerPool pool{threads - 1};
+                for (ImageDenoiser *denoiser : {&blueDenoiser, &yellowDenoiser})
+                {
+                    denoiser->configure(rois.front().size(), rois.front().type(), 5, ImageDenoiser::carRegion(rois.front().size()), threads);
+                }
+                auto stages = [&](const cv::Mat &roi) {
+                    fusedStage.prepare(roi, maskBlue, maskYellow);
+                    pool.run(threads, [&](size_t strip) {
+                        fusedStage.processRows(roi, maskBlue, maskYellow, static_cast<int>(static_cast<size_t>(roi.rows) * strip / threads),
+                                               static_cast<int>(static_cast<size_t>(roi.rows) * (strip + 1) / threads));
+                    });
+                    processed.create(roi.size(), CV_8U);
+                    otherProcessed.create(roi.size(), CV_8U);
+                    pool.run(2 * threads, [&](size_t task) {
+                        if (task < threads)
+                        {
+                            blueBranch.denoiseStrip(roi, maskBlue, processed, THRESHOLD, MAX_VALUE, task);
+                        }
+                        else
+                        {
+                            yellowBranch.denoiseStrip(roi, maskYellow, otherProcessed, THRESHOLD, MAX_VALUE, task - threads);
+                        }
+                    });
+                    pool.run(2, [&](size_t branch) {
+                        if (branch == 0)
+                        {
+                            blueBranch.detect(processed, ROI_TOP, imageCenter);
+                        }
+                        else
+                        {
+                            yellowBranch.detect(otherProcessed, ROI_TOP, imageCenter);
+                        }
+                    });
+                    blueBranch.finishFrame();
+                    yellowBranch.finishFrame();
+                };
+                LatencySummary strips = runCase("strips-" + std::to_string(threads), rois, REPEAT, stages);
+                if (threads == 1)
+                {
+                    singleThread = strips.mean;
+                }
+                std::cout << "  speedup " << singleThread / strips.mean << " with " << threads << " threads" << std::endl;
+
+                // The halo rows make the strips independent, every thread count has to give the same masks
+                for (size_t i = 0; i < rois.size(); i += 10)
+                {
+                    stages(rois[i]);
+                    if (threads == 1)
+                    {
+                        referenceBlue.push_back(processed.clone());
+                        referenceYellow.push_back(otherProcessed.clone());
+                        continue;
+                    }
+                    cv::compare(referenceBlue[i / 10], processed, difference, cv::CMP_NE);
+                    mismatchedPixels += static_cast<size_t>(cv::countNonZero(difference));
+                    cv::compare(referenceYellow[i / 10], otherProcessed, difference, cv::CMP_NE);
+                    mismatchedPixels += static_cast<size_t>(cv::countNonZero(difference));
+                }
+            }
+            std::cout << "strips differ from a single strip in " << mismatchedPixels << " pixels" << std::endl;
+            if (mismatchedPixels != 0)
+            {
+                return retCode;
+            }
+
+            retCode = 0;
+        }
+    }
+    return retCode;
+}
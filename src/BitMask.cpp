@@ -0,0 +1,527 @@
+#include "BitMask.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+
+const size_t WORD_BITS = 64;
+const uint64_t ALL_BITS = ~static_cast<uint64_t>(0);
+
+// Bits of a word shifted towards higher x by count (1 to 63) pixels, the lower bits come from the previous word
+inline uint64_t shiftUp(const uint64_t *bits, size_t i, int count, uint64_t before)
+{
+    const uint64_t previous = (i > 0) ? bits[i - 1] : before;
+    return (bits[i] << count) | (previous >> (WORD_BITS - static_cast<size_t>(count)));
+}
+
+// Bits of a word shifted towards lower x by count (1 to 63) pixels, the upper bits come from the next word
+inline uint64_t shiftDown(const uint64_t *bits, size_t i, size_t words, int count, uint64_t after)
+{
+    const uint64_t next = (i + 1 < words) ? bits[i + 1] : after;
+    return (bits[i] >> count) | (next << (WORD_BITS - static_cast<size_t>(count)));
+}
+
+// The row together with its left and right neighbours, for 8-connectivity
+inline uint64_t spread(const uint64_t *bits, size_t i, size_t words)
+{
+    return bits[i] | shiftUp(bits, i, 1, 0) | shiftDown(bits, i, words, 1, 0);
+}
+
+// Shifts the whole row by any number of pixels, the pixels shifted in from outside of the row are fill
+void shiftRow(const uint64_t *bits, size_t words, int count, uint64_t fill, uint64_t *result)
+{
+    const size_t wordShift = static_cast<size_t>(std::abs(count)) / WORD_BITS;
+    const int bitShift = std::abs(count) % static_cast<int>(WORD_BITS);
+    for (size_t i = 0; i < words; i++)
+    {
+        if (count > 0)
+        {
+            const uint64_t word = (i >= wordShift) ? bits[i - wordShift] : fill;
+            const uint64_t previous = (i >= wordShift + 1) ? bits[i - wordShift - 1] : fill;
+            result[i] = (bitShift == 0) ? word : ((word << bitShift) | (previous >> (WORD_BITS - static_cast<size_t>(bitShift))));
+        }
+        else
+        {
+            const uint64_t word = (i + wordShift < words) ? bits[i + wordShift] : fill;
+            const uint64_t next = (i + wordShift + 1 < words) ? bits[i + wordShift + 1] : fill;
+            result[i] = (bitShift == 0) ? word : ((word >> bitShift) | (next << (WORD_BITS - static_cast<size_t>(bitShift))));
+        }
+    }
+}
+
+} // namespace
+
+BitMask::BitMask()
+    : width(0), height(0), wordsPerRow(0), words(), blobBits(), outsideBits(), rowBits()
+{
+}
+
+void BitMask::create(int maskWidth, int maskHeight)
+{
+    width = maskWidth;
+    height = maskHeight;
+    wordsPerRow = (static_cast<size_t>(width) + WORD_BITS - 1) / WORD_BITS;
+    words.assign(wordsPerRow * static_cast<size_t>(height), 0);
+    blobBits.assign(words.size(), 0);
+    rowBits.assign(2 * wordsPerRow, 0);
+}
+
+void BitMask::clear()
+{
+    std::fill(words.begin(), words.end(), 0);
+}
+
+int BitMask::getWidth() const
+{
+    return width;
+}
+
+int BitMask::getHeight() const
+{
+    return height;
+}
+
+size_t BitMask::getWordsPerRow() const
+{
+    return wordsPerRow;
+}
+
+uint64_t *BitMask::row(int y)
+{
+    return &words[static_cast<size_t>(y) * wordsPerRow];
+}
+
+const uint64_t *BitMask::row(int y) const
+{
+    return &words[static_cast<size_t>(y) * wordsPerRow];
+}
+
+bool BitMask::get(int x, int y) const
+{
+    return ((row(y)[static_cast<size_t>(x) / WORD_BITS] >> (static_cast<size_t>(x) % WORD_BITS)) & 1) != 0;
+}
+
+void BitMask::set(int x, int y, bool value)
+{
+    const uint64_t bit = static_cast<uint64_t>(1) << (static_cast<size_t>(x) % WORD_BITS);
+    uint64_t &word = row(y)[static_cast<size_t>(x) / WORD_BITS];
+    word = value ? (word | bit) : (word & ~bit);
+}
+
+void BitMask::pack(const uint8_t *pixels, size_t step)
+{
+    const size_t w = static_cast<size_t>(width);
+    for (int y = 0; y < height; y++)
+    {
+        const uint8_t *pixelRow = pixels + static_cast<size_t>(y) * step;
+        uint64_t *bits = row(y);
+        std::fill_n(bits, wordsPerRow, 0);
+
+        // Eight pixels at a time: the top bit of every byte that is not 0 is set, then the multiplication
+        // gathers the eight top bits into the highest byte
+        size_t x = 0;
+        for (; x + 8 <= w; x += 8)
+        {
+            uint64_t eight;
+            std::memcpy(&eight, pixelRow + x, 8);
+            const uint64_t nonZero = (((eight & 0x7f7f7f7f7f7f7f7fULL) + 0x7f7f7f7f7f7f7f7fULL) | eight) & 0x8080808080808080ULL;
+            const uint64_t gathered = ((nonZero >> 7) * 0x0102040810204080ULL) >> 56;
+            bits[x / WORD_BITS] |= gathered << (x % WORD_BITS);
+        }
+        for (; x < w; x++)
+        {
+            bits[x / WORD_BITS] |= static_cast<uint64_t>(pixelRow[x] != 0) << (x % WORD_BITS);
+        }
+    }
+}
+
+void BitMask::unpack(uint8_t *pixels, size_t step, uint8_t value) const
+{
+    const size_t w = static_cast<size_t>(width);
+    for (int y = 0; y < height; y++)
+    {
+        uint8_t *pixelRow = pixels + static_cast<size_t>(y) * step;
+        const uint64_t *bits = row(y);
+        for (size_t x = 0; x < w; x++)
+        {
+            pixelRow[x] = (((bits[x / WORD_BITS] >> (x % WORD_BITS)) & 1) != 0) ? value : 0;
+        }
+    }
+}
+
+BitMask &BitMask::operator&=(const BitMask &other)
+{
+    for (size_t i = 0; i < words.size(); i++)
+    {
+        words[i] &= other.words[i];
+    }
+    return *this;
+}
+
+BitMask &BitMask::operator|=(const BitMask &other)
+{
+    for (size_t i = 0; i < words.size(); i++)
+    {
+        words[i] |= other.words[i];
+    }
+    return *this;
+}
+
+size_t BitMask::count() const
+{
+    size_t pixels = 0;
+    for (uint64_t word : words)
+    {
+        pixels += static_cast<size_t>(__builtin_popcountll(word));
+    }
+    return pixels;
+}
+
+void BitMask::dilate(int radiusX, int radiusY, BitMask &result) const
+{
+    result.create(width, height);
+    uint64_t *shifted = &result.rowBits[0];
+    for (int y = 0; y < height; y++)
+    {
+        // Vertical pass: all rows of the clipped rectangle
+        uint64_t *out = result.row(y);
+        for (int source = std::max(0, y - radiusY); source <= std::min(height - 1, y + radiusY); source++)
+        {
+            const uint64_t *bits = row(source);
+            for (size_t i = 0; i < wordsPerRow; i++)
+            {
+                out[i] |= bits[i];
+            }
+        }
+
+        // Horizontal pass: the row shifted by every offset of the rectangle, 0 is shifted in from outside
+        uint64_t *column = &result.rowBits[wordsPerRow];
+        std::copy_n(out, wordsPerRow, column);
+        for (int offset = 1; offset <= radiusX; offset++)
+        {
+            for (int direction : {offset, -offset})
+            {
+                shiftRow(column, wordsPerRow, direction, 0, shifted);
+                for (size_t i = 0; i < wordsPerRow; i++)
+                {
+                    out[i] |= shifted[i];
+                }
+            }
+        }
+        out[wordsPerRow - 1] &= ~lastWordMask();
+    }
+}
+
+void BitMask::erode(int radiusX, int radiusY, BitMask &result) const
+{
+    result.create(width, height);
+    uint64_t *shifted = &result.rowBits[0];
+    for (int y = 0; y < height; y++)
+    {
+        // Vertical pass: all rows of the clipped rectangle
+        uint64_t *out = result.row(y);
+        std::fill_n(out, wordsPerRow, ALL_BITS);
+        for (int source = std::max(0, y - radiusY); source <= std::min(height - 1, y + radiusY); source++)
+        {
+            const uint64_t *bits = row(source);
+            for (size_t i = 0; i < wordsPerRow; i++)
+            {
+                out[i] &= bits[i];
+            }
+        }
+
+        // Horizontal pass: outside of the row everything is set, so that the rectangle is clipped
+        uint64_t *column = &result.rowBits[wordsPerRow];
+        std::copy_n(out, wordsPerRow, column);
+        column[wordsPerRow - 1] |= lastWordMask();
+        for (int offset = 1; offset <= radiusX; offset++)
+        {
+            for (int direction : {offset, -offset})
+            {
+                shiftRow(column, wordsPerRow, direction, ALL_BITS, shifted);
+                for (size_t i = 0; i < wordsPerRow; i++)
+                {
+                    out[i] &= shifted[i];
+                }
+            }
+        }
+        out[wordsPerRow - 1] &= ~lastWordMask();
+    }
+}
+
+void BitMask::extractBlobs(std::vector<BitMaskBlob> &blobs)
+{
+    blobs.clear();
+    for (int y = 0; y < height; y++)
+    {
+        uint64_t *bits = row(y);
+        for (size_t i = 0; i < wordsPerRow; i++)
+        {
+            // Every blob removes its pixels, so the same word is scanned again until it is empty
+            while (bits[i] != 0)
+            {
+                const int x = static_cast<int>(i * WORD_BITS) + __builtin_ctzll(bits[i]);
+                BitMaskBlob blob;
+                extractBlob(x, y, blob);
+                blobs.push_back(blob);
+            }
+        }
+    }
+}
+
+uint64_t BitMask::lastWordMask() const
+{
+    const size_t used = static_cast<size_t>(width) % WORD_BITS;
+    return (used == 0) ? 0 : (ALL_BITS << used);
+}
+
+void BitMask::fillRow(uint64_t *bits, const uint64_t *allowed, size_t count, size_t &firstWord, size_t &lastWord) const
+{
+    // Kogge-Stone fill towards higher x inside every word, carried over into the next words as long as the run goes on
+    uint64_t carry = 0;
+    for (size_t i = firstWord; i < count && (i <= lastWord || (carry & allowed[i]) != 0); i++)
+    {
+        uint64_t fill = bits[i] | (carry & allowed[i]);
+        uint64_t open = allowed[i];
+        fill |= open & (fill << 1);
+        open &= open << 1;
+        fill |= open & (fill << 2);
+        open &= open << 2;
+        fill |= open & (fill << 4);
+        open &= open << 4;
+        fill |= open & (fill << 8);
+        open &= open << 8;
+        fill |= open & (fill << 16);
+        open &= open << 16;
+        fill |= open & (fill << 32);
+        bits[i] = fill;
+        carry = fill >> 63;
+        lastWord = std::max(lastWord, i);
+    }
+
+    // The same towards lower x
+    carry = 0;
+    for (size_t i = lastWord + 1; i-- > 0 && (i >= firstWord || ((carry << 63) & allowed[i]) != 0);)
+    {
+        uint64_t fill = bits[i] | ((carry << 63) & allowed[i]);
+        uint64_t open = allowed[i];
+        fill |= open & (fill >> 1);
+        open &= open >> 1;
+        fill |= open & (fill >> 2);
+        open &= open >> 2;
+        fill |= open & (fill >> 4);
+        open &= open >> 4;
+        fill |= open & (fill >> 8);
+        open &= open >> 8;
+        fill |= open & (fill >> 16);
+        open &= open >> 16;
+        fill |= open & (fill >> 32);
+        bits[i] = fill;
+        carry = fill & 1;
+        firstWord = std::min(firstWord, i);
+    }
+}
+
+void BitMask::extractBlob(int seedX, int seedY, BitMaskBlob &blob)
+{
+    const size_t last = wordsPerRow - 1;
+    uint64_t *candidate = &rowBits[0];
+    auto blobRow = [this](int y) { return &blobBits[static_cast<size_t>(y) * wordsPerRow]; };
+
+    // Grow the blob from the seed: every row takes the pixels of the mask next to the blob in the rows above and
+    // below, extended along their horizontal runs. Sweeping down and up again until nothing changes follows
+    // the blob in both directions.
+    blobRow(seedY)[static_cast<size_t>(seedX) / WORD_BITS] |= static_cast<uint64_t>(1) << (static_cast<size_t>(seedX) % WORD_BITS);
+    int top = seedY;
+    int bottom = seedY;
+    size_t firstWord = static_cast<size_t>(seedX) / WORD_BITS;
+    size_t lastWord = firstWord;
+    fillRow(blobRow(seedY), row(seedY), wordsPerRow, firstWord, lastWord);
+    bool down = true;
+    bool changed = true;
+    while (changed)
+    {
+        // A sweep that changes nothing means that the blob is complete
+        changed = false;
+        for (int y = down ? std::max(0, top - 1) : std::min(height - 1, bottom + 1);
+             down ? (y <= std::min(height - 1, bottom + 1)) : (y >= std::max(0, top - 1));
+             y += down ? 1 : -1)
+        {
+            uint64_t *bits = blobRow(y);
+            const uint64_t *mask = row(y);
+            const uint64_t *above = (y > 0) ? blobRow(y - 1) : nullptr;
+            const uint64_t *below = (y + 1 < height) ? blobRow(y + 1) : nullptr;
+
+            // Only the words next to the blob can change, a run may continue into the words after them
+            std::copy_n(bits, wordsPerRow, candidate);
+            size_t rowFirst = (firstWord > 0) ? firstWord - 1 : 0;
+            size_t rowLast = std::min(last, lastWord + 1);
+            bool grows = false;
+            for (size_t i = rowFirst; i <= rowLast; i++)
+            {
+                uint64_t next = bits[i];
+                next |= (above != nullptr) ? spread(above, i, wordsPerRow) : 0;
+                next |= (below != nullptr) ? spread(below, i, wordsPerRow) : 0;
+                candidate[i] = next & mask[i];
+                grows = grows || (candidate[i] != bits[i]);
+            }
+            if (!grows)
+            {
+                continue;
+            }
+
+            fillRow(candidate, mask, wordsPerRow, rowFirst, rowLast);
+            std::copy(candidate + rowFirst, candidate + rowLast + 1, bits + rowFirst);
+            firstWord = std::min(firstWord, rowFirst);
+            lastWord = std::max(lastWord, rowLast);
+            top = std::min(top, y);
+            bottom = std::max(bottom, y);
+            changed = true;
+        }
+        down = !down;
+    }
+
+    // Bounding box and area, then the pixels of the blob are removed from the mask
+    // A hole needs a row in which background lies between two pixels of the blob
+    uint64_t *columns = &rowBits[wordsPerRow];
+    std::fill_n(columns, wordsPerRow, 0);
+    size_t area = 0;
+    bool gaps = false;
+    for (int y = top; y <= bottom; y++)
+    {
+        uint64_t *bits = blobRow(y);
+        uint64_t *mask = row(y);
+        size_t rowArea = 0;
+        size_t rowFirst = lastWord;
+        size_t rowLast = firstWord;
+        for (size_t i = firstWord; i <= lastWord; i++)
+        {
+            columns[i] |= bits[i];
+            rowArea += static_cast<size_t>(__builtin_popcountll(bits[i]));
+            mask[i] &= ~bits[i];
+            if (bits[i] != 0)
+            {
+                rowFirst = std::min(rowFirst, i);
+                rowLast = std::max(rowLast, i);
+            }
+        }
+        const size_t rowLeft = rowFirst * WORD_BITS + static_cast<size_t>(__builtin_ctzll(bits[rowFirst]));
+        const size_t rowRight = rowLast * WORD_BITS + 63 - static_cast<size_t>(__builtin_clzll(bits[rowLast]));
+        gaps = gaps || (rowArea != rowRight - rowLeft + 1);
+        area += rowArea;
+    }
+    while (columns[firstWord] == 0)
+    {
+        firstWord++;
+    }
+    while (columns[lastWord] == 0)
+    {
+        lastWord--;
+    }
+    const int left = static_cast<int>(firstWord * WORD_BITS) + __builtin_ctzll(columns[firstWord]);
+    const int right = static_cast<int>(lastWord * WORD_BITS) + 63 - __builtin_clzll(columns[lastWord]);
+
+    blob.x = left;
+    blob.y = top;
+    blob.width = right - left + 1;
+    blob.height = bottom - top + 1;
+    blob.area = area;
+
+    // Blobs inside a hole of this blob are not external, so the holes are cleared from the mask. Inside the bounding
+    // box, the background that is 4-connected to its border is outside; the rest of the background is a hole.
+    if (gaps && blob.height > 2)
+    {
+        const size_t boxWords = lastWord - firstWord + 1;
+        outsideBits.assign(static_cast<size_t>(blob.height) * 2 * boxWords, 0);
+        auto outsideRow = [&](int y) { return &outsideBits[static_cast<size_t>(y - top) * 2 * boxWords]; };
+        auto backgroundRow = [&](int y) { return &outsideBits[(static_cast<size_t>(y - top) * 2 + 1) * boxWords]; };
+
+        // Background of the bounding box, and its pixels on the border of the box as the start of the outside
+        for (int y = top; y <= bottom; y++)
+        {
+            const uint64_t *bits = blobRow(y);
+            uint64_t *background = backgroundRow(y);
+            uint64_t *outside = outsideRow(y);
+            for (size_t i = 0; i < boxWords; i++)
+            {
+                const size_t word = firstWord + i;
+                const size_t lowBit = word * WORD_BITS;
+                uint64_t box = ALL_BITS;
+                if (static_cast<size_t>(left) > lowBit)
+                {
+                    box &= ALL_BITS << (static_cast<size_t>(left) - lowBit);
+                }
+                if (static_cast<size_t>(right) < lowBit + 63)
+                {
+                    box &= ALL_BITS >> (lowBit + 63 - static_cast<size_t>(right));
+                }
+                background[i] = ~bits[word] & box;
+
+                uint64_t border = 0;
+                if (y == top || y == bottom)
+                {
+                    border = box;
+                }
+                if (static_cast<size_t>(left) / WORD_BITS == word)
+                {
+                    border |= static_cast<uint64_t>(1) << (static_cast<size_t>(left) % WORD_BITS);
+                }
+                if (static_cast<size_t>(right) / WORD_BITS == word)
+                {
+                    border |= static_cast<uint64_t>(1) << (static_cast<size_t>(right) % WORD_BITS);
+                }
+                outside[i] = background[i] & border;
+            }
+        }
+
+        // Grow the outside through the background with 4-connectivity
+        changed = true;
+        while (changed)
+        {
+            changed = false;
+            for (int pass = 0; pass < 2; pass++)
+            {
+                const bool downwards = (pass == 0);
+                for (int y = downwards ? top : bottom; downwards ? (y <= bottom) : (y >= top); y += downwards ? 1 : -1)
+                {
+                    uint64_t *outside = outsideRow(y);
+                    const uint64_t *background = backgroundRow(y);
+                    for (size_t i = 0; i < boxWords; i++)
+                    {
+                        uint64_t next = outside[i];
+                        next |= (y > top) ? outsideRow(y - 1)[i] : 0;
+                        next |= (y < bottom) ? outsideRow(y + 1)[i] : 0;
+                        candidate[i] = next & background[i];
+                    }
+                    size_t boxFirst = 0;
+                    size_t boxLast = boxWords - 1;
+                    fillRow(candidate, background, boxWords, boxFirst, boxLast);
+                    if (!std::equal(candidate, candidate + boxWords, outside))
+                    {
+                        std::copy_n(candidate, boxWords, outside);
+                        changed = true;
+                    }
+                }
+            }
+        }
+
+        // Clear the holes, with every blob inside of them
+        for (int y = top; y <= bottom; y++)
+        {
+            const uint64_t *outside = outsideRow(y);
+            const uint64_t *background = backgroundRow(y);
+            uint64_t *mask = row(y);
+            for (size_t i = 0; i < boxWords; i++)
+            {
+                mask[firstWord + i] &= ~(background[i] & ~outside[i]);
+            }
+        }
+    }
+
+    for (int y = top; y <= bottom; y++)
+    {
+        std::fill(blobRow(y) + firstWord, blobRow(y) + lastWord + 1, 0);
+    }
+}
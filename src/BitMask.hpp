@@ -0,0 +1,79 @@
+#ifndef BIT_MASK_HPP
+#define BIT_MASK_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Bounding box and pixel count of one 8-connected blob of a BitMask
+struct BitMaskBlob {
+    int x{0};
+    int y{0};
+    int width{0};
+    int height{0};
+    size_t area{0};
+};
+
+// Binary mask with one bit per pixel. Every row starts at a new 64-bit word and pixel x of a row is bit (x % 64) of
+// word (x / 64), the bits after the last pixel of a row are always 0. All operations work on whole words, so a
+// 640 pixel row takes 10 words instead of 640 bytes.
+class BitMask {
+    public:
+        BitMask();
+
+        void create(int maskWidth, int maskHeight);
+        void clear();
+
+        int getWidth() const;
+        int getHeight() const;
+        size_t getWordsPerRow() const;
+
+        uint64_t *row(int y);
+        const uint64_t *row(int y) const;
+
+        bool get(int x, int y) const;
+        void set(int x, int y, bool value);
+
+        // Conversion from and to 8-bit masks, every pixel other than 0 is set
+        void pack(const uint8_t *pixels, size_t step);
+        void unpack(uint8_t *pixels, size_t step, uint8_t value = 255) const;
+
+        // Word-parallel operations with a mask of the same size
+        BitMask &operator&=(const BitMask &other);
+        BitMask &operator|=(const BitMask &other);
+
+        // Number of set pixels
+        size_t count() const;
+
+        // Rectangle of (2 * radiusX + 1) x (2 * radiusY + 1) pixels, the rectangle is clipped at the border like the
+        // default border of cv::dilate and cv::erode
+        void dilate(int radiusX, int radiusY, BitMask &result) const;
+        void erode(int radiusX, int radiusY, BitMask &result) const;
+
+        // Bounding boxes of the 8-connected blobs that are not inside a hole of another blob, which are the same blobs
+        // that cv::findContours finds with cv::RETR_EXTERNAL. The blobs are found in the order of their first pixel.
+        // The mask is used as scratch memory and is empty afterwards.
+        void extractBlobs(std::vector<BitMaskBlob> &blobs);
+
+    private:
+        // Marks the pixels after the last pixel of a row in the last word of the row
+        uint64_t lastWordMask() const;
+
+        // Adds the pixels of allowed that are connected to the pixels in [firstWord, lastWord] of the row through
+        // horizontal runs, the range grows with the runs
+        void fillRow(uint64_t *bits, const uint64_t *allowed, size_t words, size_t &firstWord, size_t &lastWord) const;
+
+        void extractBlob(int seedX, int seedY, BitMaskBlob &blob);
+
+        int width;
+        int height;
+        size_t wordsPerRow;
+        std::vector<uint64_t> words;
+
+        // Scratch rows of extractBlobs, reused between frames
+        std::vector<uint64_t> blobBits;
+        std::vector<uint64_t> outsideBits;
+        std::vector<uint64_t> rowBits;
+};
+
+#endif // BIT_MASK_HPP
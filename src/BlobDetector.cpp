@@ -0,0 +1,97 @@
+#include "BlobDetector.hpp"
+#include <opencv2/imgproc.hpp>
+
+BlobDetector::BlobDetector(Mode detectorMode)
+    : mode(detectorMode), filter(), contours(), bits(), blobs(), labeller(), runLabeller(), stats()
+{
+}
+
+void BlobDetector::setFilter(const Filter &boxFilter)
+{
+    filter = boxFilter;
+}
+
+bool BlobDetector::accept(const cv::Rect &box) const
+{
+    return !filter || filter(box);
+}
+
+size_t BlobDetector::detect(const cv::Mat &mask, std::vector<cv::Rect> &boxes)
+{
+    boxes.clear();
+
+    if (mode == Mode::CONTOURS)
+    {
+        cv::findContours(mask, contours, cv::RETR_EXTERNAL, cv::CHAIN_APPROX_SIMPLE);
+        for (const std::vector<cv::Point> &contour : contours)
+        {
+            cv::Rect box = cv::boundingRect(contour);
+            if (accept(box))
+            {
+                boxes.push_back(box);
+            }
+        }
+        return contours.size();
+    }
+
+    if (mode == Mode::LABELS || mode == Mode::RUNS)
+    {
+        auto statsFilter = [this](const BlobStats &blob) {
+            return accept(cv::Rect(blob.x, blob.y, blob.width, blob.height));
+        };
+        const size_t count = (mode == Mode::LABELS) ? labeller.label(mask.ptr<uint8_t>(), mask.step, mask.cols, mask.rows, statsFilter, stats)
+                                                    : runLabeller.label(mask.ptr<uint8_t>(), mask.step, mask.cols, mask.rows, statsFilter, stats);
+        for (const BlobStats &blob : stats)
+        {
+            boxes.push_back(cv::Rect(blob.x, blob.y, blob.width, blob.height));
+        }
+        return count;
+    }
+
+    // Only the packed mask is read after this, with one bit per pixel
+    if (bits.getWidth() != mask.cols || bits.getHeight() != mask.rows)
+    {
+        bits.create(mask.cols, mask.rows);
+    }
+    bits.pack(mask.ptr<uint8_t>(), mask.step);
+    bits.extractBlobs(blobs);
+    for (const BitMaskBlob &blob : blobs)
+    {
+        cv::Rect box(blob.x, blob.y, blob.width, blob.height);
+        if (accept(box))
+        {
+            boxes.push_back(box);
+        }
+    }
+    return blobs.size();
+}
+
+BlobDetector::Mode BlobDetector::getMode() const
+{
+    return mode;
+}
+
+bool BlobDetector::parseMode(const std::string &name, Mode &detectorMode)
+{
+    if (name == "contours")
+    {
+        detectorMode = Mode::CONTOURS;
+    }
+    else if (name == "bitmask")
+    {
+        detectorMode = Mode::BITMASK;
+    }
+    else if (name == "labels")
+    {
+        detectorMode = Mode::LABELS;
+    }
+    else if (name == "runs")
+    {
+        detectorMode = Mode::RUNS;
+    }
+    else
+    {
+        return false;
+    }
+    return true;
+}
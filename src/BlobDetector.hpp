@@ -0,0 +1,60 @@
+#ifndef BLOB_DETECTOR_HPP
+#define BLOB_DETECTOR_HPP
+
+#include <opencv2/core.hpp>
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "BitMask.hpp"
+#include "BlobLabeller.hpp"
+#include "RunLengthLabeller.hpp"
+
+// Finds the bounding boxes of the cone blobs in a processed mask
+class BlobDetector {
+    public:
+        enum class Mode {
+            // cv::findContours with cv::RETR_EXTERNAL and cv::boundingRect of every contour
+            CONTOURS,
+            // The mask is packed into a BitMask and the blobs are grown with word-parallel operations, which finds
+            // the same boxes without tracing the contours
+            BITMASK,
+            // One pass of BlobLabeller over the 8-bit mask, the filter is applied while the statistics of the blobs
+            // are collected
+            LABELS,
+            // RunLengthLabeller on the runs of foreground pixels of every row, the filter is applied like in LABELS
+            RUNS
+        };
+
+        // Decides from the bounding box whether a blob is kept, in the coordinates of the mask
+        using Filter = std::function<bool(const cv::Rect &)>;
+
+        explicit BlobDetector(Mode detectorMode = Mode::RUNS);
+
+        void setFilter(const Filter &boxFilter);
+
+        // Bounding boxes of the external blobs that pass the filter, in the coordinates of the mask. Returns the number
+        // of external blobs before the filter.
+        size_t detect(const cv::Mat &mask, std::vector<cv::Rect> &boxes);
+
+        Mode getMode() const;
+
+        static bool parseMode(const std::string &name, Mode &detectorMode);
+
+    private:
+        bool accept(const cv::Rect &box) const;
+
+        Mode mode;
+        Filter filter;
+
+        // Reused between frames
+        std::vector<std::vector<cv::Point>> contours;
+        BitMask bits;
+        std::vector<BitMaskBlob> blobs;
+        BlobLabeller labeller;
+        RunLengthLabeller runLabeller;
+        std::vector<BlobStats> stats;
+};
+
+#endif // BLOB_DETECTOR_HPP
@@ -0,0 +1,268 @@
+#include "BlobLabeller.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+// Label 0 is unused, background label 1 is the area around the mask
+const int32_t OUTSIDE = 1;
+
+inline uint64_t load8(const uint8_t *pixels)
+{
+    uint64_t word;
+    std::memcpy(&word, pixels, sizeof(word));
+    return word;
+}
+
+} // namespace
+
+BlobLabeller::BlobLabeller()
+    : components(), backgroundParent(), outside(), edges(), labels()
+{
+}
+
+int32_t BlobLabeller::findForeground(int32_t label)
+{
+    while (components[static_cast<size_t>(label)].parent != label)
+    {
+        Component &component = components[static_cast<size_t>(label)];
+        component.parent = components[static_cast<size_t>(component.parent)].parent;
+        label = component.parent;
+    }
+    return label;
+}
+
+int32_t BlobLabeller::findBackground(int32_t label)
+{
+    while (backgroundParent[static_cast<size_t>(label)] != label)
+    {
+        int32_t &parent = backgroundParent[static_cast<size_t>(label)];
+        parent = backgroundParent[static_cast<size_t>(parent)];
+        label = parent;
+    }
+    return label;
+}
+
+int32_t BlobLabeller::mergeForeground(int32_t first, int32_t second)
+{
+    first = findForeground(first);
+    second = findForeground(second);
+    if (first == second)
+    {
+        return first;
+    }
+
+    // The older label stays the root, so the root is always the first pixel of the blob in raster order
+    if (second < first)
+    {
+        std::swap(first, second);
+    }
+    Component &root = components[static_cast<size_t>(first)];
+    Component &child = components[static_cast<size_t>(second)];
+    child.parent = first;
+    root.minX = std::min(root.minX, child.minX);
+    root.minY = std::min(root.minY, child.minY);
+    root.maxX = std::max(root.maxX, child.maxX);
+    root.maxY = std::max(root.maxY, child.maxY);
+    root.area += child.area;
+    root.sumX += child.sumX;
+    root.sumY += child.sumY;
+    root.external = root.external || child.external;
+    return first;
+}
+
+int32_t BlobLabeller::mergeBackground(int32_t first, int32_t second)
+{
+    first = findBackground(first);
+    second = findBackground(second);
+    if (first == second)
+    {
+        return first;
+    }
+    if (second < first)
+    {
+        std::swap(first, second);
+    }
+    backgroundParent[static_cast<size_t>(second)] = first;
+    outside[static_cast<size_t>(first)] |= outside[static_cast<size_t>(second)];
+    return first;
+}
+
+void BlobLabeller::addEdge(int32_t foreground, int32_t background)
+{
+    // Neighbouring pixels mostly repeat the previous pair
+    if (edges.empty() || edges.back().first != foreground || edges.back().second != background)
+    {
+        edges.emplace_back(foreground, background);
+    }
+}
+
+size_t BlobLabeller::label(const uint8_t *pixels, size_t step, int width, int height, const Filter &filter, std::vector<BlobStats> &blobs)
+{
+    blobs.clear();
+    components.assign(1, Component{0, 0, 0, 0, 0, 0, 0, 0, false});
+    backgroundParent.assign(2, 0);
+    backgroundParent[OUTSIDE] = OUTSIDE;
+    outside.assign(2, 0);
+    outside[OUTSIDE] = 1;
+    edges.clear();
+
+    labels.assign(static_cast<size_t>(width) + 2, -OUTSIDE);
+    int32_t *rowLabels = labels.data();
+
+    for (int y = 0; y < height; y++)
+    {
+        const uint8_t *row = pixels + static_cast<size_t>(y) * step;
+        const uint8_t *previousRow = (y > 0) ? row - step : nullptr;
+        const bool lastRow = (y == height - 1);
+        int32_t northWest = -OUTSIDE;
+
+        for (int x = 0; x < width; x++)
+        {
+            const size_t i = static_cast<size_t>(x) + 1;
+            const int32_t west = rowLabels[i - 1];
+            const int32_t north = rowLabels[i];
+
+            // Background below background continues the background on the left. The background above is one run of
+            // the previous row and therefore one component, so the whole span needs one merge at most, and the labels
+            // of the previous row stay valid for it without being written. The last column and the last row are left
+            // to the pixel loop, they touch the outside.
+            if (west < 0 && previousRow != nullptr && !lastRow)
+            {
+                int end = x;
+                while (end + 8 < width && (load8(row + end) | load8(previousRow + end)) == 0)
+                {
+                    end += 8;
+                }
+                if (end > x)
+                {
+                    if (west != north)
+                    {
+                        mergeBackground(-west, -north);
+                    }
+                    x = end - 1;
+                    northWest = rowLabels[static_cast<size_t>(end)];
+                    continue;
+                }
+            }
+
+            if (row[x] != 0)
+            {
+                // 8-connected: west, north-west, north and north-east
+                int32_t label = 0;
+                for (int32_t neighbour : {west, northWest, north, rowLabels[i + 1]})
+                {
+                    if (neighbour > 0)
+                    {
+                        label = (label == 0) ? findForeground(neighbour) : mergeForeground(label, neighbour);
+                    }
+                }
+                if (label == 0)
+                {
+                    label = static_cast<int32_t>(components.size());
+                    components.push_back(Component{label, x, y, x, y, 0, 0, 0, false});
+                }
+
+                Component &component = components[static_cast<size_t>(label)];
+                component.minX = std::min(component.minX, x);
+                component.maxX = std::max(component.maxX, x);
+                component.maxY = y;
+                component.area++;
+                component.sumX += static_cast<uint64_t>(x);
+                component.sumY += static_cast<uint64_t>(y);
+
+                // A blob that touches the border of the mask is never inside another blob
+                if (x == 0 || y == 0 || x == width - 1 || lastRow)
+                {
+                    component.external = true;
+                }
+                else
+                {
+                    if (west < 0)
+                    {
+                        addEdge(label, -west);
+                    }
+                    if (north < 0)
+                    {
+                        addEdge(label, -north);
+                    }
+                }
+                northWest = north;
+                rowLabels[i] = label;
+            }
+            else
+            {
+                // 4-connected: west and north
+                int32_t label = 0;
+                if (west < 0 && north < 0)
+                {
+                    label = (west == north) ? -west : mergeBackground(-west, -north);
+                }
+                else if (west < 0)
+                {
+                    label = -west;
+                }
+                else if (north < 0)
+                {
+                    label = -north;
+                }
+                else
+                {
+                    label = static_cast<int32_t>(backgroundParent.size());
+                    backgroundParent.push_back(label);
+                    outside.push_back(0);
+                }
+
+                if (x == width - 1 || lastRow)
+                {
+                    label = mergeBackground(label, OUTSIDE);
+                }
+                if (west > 0)
+                {
+                    addEdge(west, label);
+                }
+                if (north > 0)
+                {
+                    addEdge(north, label);
+                }
+                northWest = north;
+                rowLabels[i] = -label;
+            }
+        }
+    }
+
+    // Blobs next to the background around the mask are external, the others are inside a hole of another blob
+    for (const std::pair<int32_t, int32_t> &edge : edges)
+    {
+        if (outside[static_cast<size_t>(findBackground(edge.second))] != 0)
+        {
+            components[static_cast<size_t>(findForeground(edge.first))].external = true;
+        }
+    }
+
+    size_t count = 0;
+    for (size_t i = 1; i < components.size(); i++)
+    {
+        const Component &component = components[i];
+        if (component.parent != static_cast<int32_t>(i) || !component.external)
+        {
+            continue;
+        }
+        count++;
+
+        BlobStats blob;
+        blob.x = component.minX;
+        blob.y = component.minY;
+        blob.width = component.maxX - component.minX + 1;
+        blob.height = component.maxY - component.minY + 1;
+        blob.area = component.area;
+        blob.centroidX = static_cast<double>(component.sumX) / static_cast<double>(component.area);
+        blob.centroidY = static_cast<double>(component.sumY) / static_cast<double>(component.area);
+        if (!filter || filter(blob))
+        {
+            blobs.push_back(blob);
+        }
+    }
+    return count;
+}
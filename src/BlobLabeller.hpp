@@ -0,0 +1,71 @@
+#ifndef BLOB_LABELLER_HPP
+#define BLOB_LABELLER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <utility>
+#include <vector>
+
+// Statistics of one 8-connected blob, collected while the mask is labelled
+struct BlobStats {
+    int x{0};
+    int y{0};
+    int width{0};
+    int height{0};
+    size_t area{0};
+    double centroidX{0};
+    double centroidY{0};
+};
+
+// Single pass connected component labeller for 8-bit masks. Every pixel is labelled once in raster order, the labels
+// of touching components are merged with union-find and the statistics of a component are merged with it. Only one
+// row of labels is kept, no label image and no contour points are stored.
+//
+// The background is labelled too, with 4-connectivity, so that blobs inside a hole of another blob can be dropped:
+// the result is the same set of blobs that cv::findContours finds with cv::RETR_EXTERNAL.
+class BlobLabeller {
+    public:
+        using Filter = std::function<bool(const BlobStats &)>;
+
+        BlobLabeller();
+
+        // Blobs that pass the filter, in the order of their first pixel. Returns the number of blobs before the filter.
+        size_t label(const uint8_t *pixels, size_t step, int width, int height, const Filter &filter, std::vector<BlobStats> &blobs);
+
+    private:
+        // Foreground component, the merged statistics are kept at the root
+        struct Component {
+            int32_t parent;
+            int minX;
+            int minY;
+            int maxX;
+            int maxY;
+            size_t area;
+            uint64_t sumX;
+            uint64_t sumY;
+            bool external;
+        };
+
+        int32_t findForeground(int32_t label);
+        int32_t findBackground(int32_t label);
+        int32_t mergeForeground(int32_t first, int32_t second);
+        int32_t mergeBackground(int32_t first, int32_t second);
+        void addEdge(int32_t foreground, int32_t background);
+
+        std::vector<Component> components;
+
+        // Background components, a component is outside of every blob when it touches the border of the mask
+        std::vector<int32_t> backgroundParent;
+        std::vector<uint8_t> outside;
+
+        // Foreground and background components that touch, a blob is external once one of them is outside
+        std::vector<std::pair<int32_t, int32_t>> edges;
+
+        // One row of labels with one border label on both sides, updated in place: left of the current pixel it holds
+        // the labels of the current row, from the current pixel on the labels of the previous row. Labels of
+        // foreground pixels are positive and labels of background pixels negative.
+        std::vector<int32_t> labels;
+};
+
+#endif // BLOB_LABELLER_HPP
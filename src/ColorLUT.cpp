@@ -0,0 +1,81 @@
+#include "ColorLUT.hpp"
+
+namespace {
+
+// Number of possible 24-bit colors
+const size_t COLORS = static_cast<size_t>(1) << 24;
+// Four 2-bit labels are packed into every byte
+const size_t LABELS_PER_BYTE = 4;
+
+inline size_t colorIndex(uint8_t b, uint8_t g, uint8_t r)
+{
+    return (static_cast<size_t>(b) << 16) | (static_cast<size_t>(g) << 8) | r;
+}
+
+} // namespace
+
+ColorLUT::ColorLUT()
+    : table()
+{
+}
+
+void ColorLUT::build(const HsvRange &blue, const HsvRange &yellow)
+{
+    table.assign(COLORS / LABELS_PER_BYTE, 0);
+
+    // Classify the colors 256 at a time with the fused kernel, so the table gives exactly the same masks
+    uint8_t row[256 * 3];
+    uint8_t rowBlue[256];
+    uint8_t rowYellow[256];
+    for (int b = 0; b < 256; b++)
+    {
+        for (int g = 0; g < 256; g++)
+        {
+            for (int r = 0; r < 256; r++)
+            {
+                row[r * 3] = static_cast<uint8_t>(b);
+                row[r * 3 + 1] = static_cast<uint8_t>(g);
+                row[r * 3 + 2] = static_cast<uint8_t>(r);
+            }
+            ConeColorKernel::classify(row, 3, 256, blue, yellow, rowBlue, rowYellow);
+
+            uint8_t *packed = &table[colorIndex(static_cast<uint8_t>(b), static_cast<uint8_t>(g), 0) / LABELS_PER_BYTE];
+            for (int r = 0; r < 256; r++)
+            {
+                uint8_t value = static_cast<uint8_t>((rowBlue[r] ? BLUE : 0) | (rowYellow[r] ? YELLOW : 0));
+                packed[r / LABELS_PER_BYTE] = static_cast<uint8_t>(packed[r / LABELS_PER_BYTE] | (value << ((r % LABELS_PER_BYTE) * 2)));
+            }
+        }
+    }
+}
+
+bool ColorLUT::isBuilt() const
+{
+    return !table.empty();
+}
+
+uint8_t ColorLUT::label(uint8_t b, uint8_t g, uint8_t r) const
+{
+    size_t index = colorIndex(b, g, r);
+    return static_cast<uint8_t>((table[index / LABELS_PER_BYTE] >> ((index % LABELS_PER_BYTE) * 2)) & 3);
+}
+
+void ColorLUT::classify(const uint8_t *pixels, int channels, size_t count, uint8_t *maskBlue, uint8_t *maskYellow) const
+{
+    const uint8_t *lookup = table.data();
+    for (size_t i = 0; i < count; i++)
+    {
+        const uint8_t *pixel = pixels + i * static_cast<size_t>(channels);
+        size_t index = colorIndex(pixel[0], pixel[1], pixel[2]);
+        unsigned value = static_cast<unsigned>(lookup[index / LABELS_PER_BYTE] >> ((index % LABELS_PER_BYTE) * 2));
+
+        // Turn the label bits into 0/255 mask values without branches
+        maskBlue[i] = static_cast<uint8_t>(0 - (value & BLUE));
+        maskYellow[i] = static_cast<uint8_t>(0 - ((value >> 1) & 1));
+    }
+}
+
+size_t ColorLUT::memoryFootprint() const
+{
+    return table.capacity();
+}
@@ -0,0 +1,31 @@
+#ifndef COLOR_LUT_HPP
+#define COLOR_LUT_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "ConeColorKernel.hpp"
+
+// Lookup table from every 24-bit BGR color to its cone color label, so that classification is one lookup per pixel.
+// Each color takes two bits (blue, yellow), which makes the table 4 MiB large.
+class ColorLUT {
+    public:
+        static const uint8_t BLUE = 1;
+        static const uint8_t YELLOW = 2;
+
+        ColorLUT();
+
+        void build(const HsvRange &blue, const HsvRange &yellow);
+        bool isBuilt() const;
+
+        uint8_t label(uint8_t b, uint8_t g, uint8_t r) const;
+        void classify(const uint8_t *pixels, int channels, size_t count, uint8_t *maskBlue, uint8_t *maskYellow) const;
+
+        size_t memoryFootprint() const;
+
+    private:
+        std::vector<uint8_t> table;
+};
+
+#endif // COLOR_LUT_HPP
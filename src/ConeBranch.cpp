@@ -0,0 +1,82 @@
+#include "ConeBranch.hpp"
+
+#include <chrono>
+
+ConeBranch::ConeBranch(const std::string &branchName, ImageDenoiser &branchDenoiser, BlobDetector::Mode blobMode)
+    : denoiser(branchDenoiser), detector(blobMode), boxes(), averageDistance(0), durationStats(branchName), frameNanoseconds(0)
+{
+}
+
+void ConeBranch::setFilter(const BlobDetector::Filter &filter)
+{
+    detector.setFilter(filter);
+}
+
+void ConeBranch::process(const cv::Mat &imageROI, const cv::Mat &mask, cv::Mat &processed, int thresholdValue, int maxValue,
+                         int roiTop, const cv::Point &imageCenter)
+{
+    auto start = std::chrono::steady_clock::now();
+    denoiser.denoiseImage(imageROI, mask, processed, thresholdValue, maxValue);
+    addTime(std::chrono::steady_clock::now() - start);
+
+    detect(processed, roiTop, imageCenter);
+    finishFrame();
+}
+
+size_t ConeBranch::getStripCount() const
+{
+    return denoiser.getStripCount();
+}
+
+void ConeBranch::denoiseStrip(const cv::Mat &imageROI, const cv::Mat &mask, cv::Mat &processed, int thresholdValue, int maxValue, size_t strip)
+{
+    auto start = std::chrono::steady_clock::now();
+    denoiser.denoiseStrip(imageROI, mask, processed, thresholdValue, maxValue, strip);
+    addTime(std::chrono::steady_clock::now() - start);
+}
+
+void ConeBranch::detect(const cv::Mat &processed, int roiTop, const cv::Point &imageCenter)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    const size_t blobs = detector.detect(processed, boxes);
+
+    double distance = 0;
+    for (cv::Rect &rect : boxes)
+    {
+        // Adjust the rectangle to the ROI
+        rect.y += roiTop;
+
+        // Add the distance from the car to the center of a cone
+        cv::Point center = (rect.tl() + rect.br()) / 2;
+        distance += cv::norm(imageCenter - center);
+    }
+    averageDistance = (blobs != 0) ? distance / static_cast<double>(blobs) : 0;
+
+    addTime(std::chrono::steady_clock::now() - start);
+}
+
+void ConeBranch::finishFrame()
+{
+    durationStats.add(std::chrono::nanoseconds(frameNanoseconds.exchange(0)));
+}
+
+void ConeBranch::addTime(std::chrono::steady_clock::duration duration)
+{
+    frameNanoseconds += std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count();
+}
+
+const std::vector<cv::Rect> &ConeBranch::getBoxes() const
+{
+    return boxes;
+}
+
+double ConeBranch::getAverageDistance() const
+{
+    return averageDistance;
+}
+
+DurationStats &ConeBranch::getDurationStats()
+{
+    return durationStats;
+}
@@ -0,0 +1,59 @@
+#ifndef CONE_BRANCH_HPP
+#define CONE_BRANCH_HPP
+
+#include <opencv2/core.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "BlobDetector.hpp"
+#include "DurationStats.hpp"
+#include "ImageDenoiser.hpp"
+
+// Everything one cone color does after the color classification: denoising of its mask, blob detection and the
+// average distance to its cones. The blue and the yellow branch share no state, so they can run at the same time.
+class ConeBranch {
+    public:
+        ConeBranch(const std::string &branchName, ImageDenoiser &branchDenoiser, BlobDetector::Mode blobMode);
+
+        ConeBranch(const ConeBranch &) = delete;
+        ConeBranch &operator=(const ConeBranch &) = delete;
+
+        // Filter of the blob detector, in the coordinates of the region of interest
+        void setFilter(const BlobDetector::Filter &filter);
+
+        // Processes the mask of the current frame, the region of interest starts at row roiTop of the frame
+        void process(const cv::Mat &imageROI, const cv::Mat &mask, cv::Mat &processed, int thresholdValue, int maxValue,
+                     int roiTop, const cv::Point &imageCenter);
+
+        // The same split into steps for several threads: denoiseStrip for every strip of the denoiser, which may run
+        // at the same time, then detect, then finishFrame. processed has to be allocated with the size of the mask.
+        size_t getStripCount() const;
+        void denoiseStrip(const cv::Mat &imageROI, const cv::Mat &mask, cv::Mat &processed, int thresholdValue, int maxValue, size_t strip);
+        void detect(const cv::Mat &processed, int roiTop, const cv::Point &imageCenter);
+        void finishFrame();
+
+        // Cones of the last frame in the coordinates of the frame
+        const std::vector<cv::Rect> &getBoxes() const;
+        // Summed distance to the cones divided by the number of all blobs, including the filtered ones
+        double getAverageDistance() const;
+
+        // How long the steps of a frame take together, on whichever thread they run
+        DurationStats &getDurationStats();
+
+    private:
+        void addTime(std::chrono::steady_clock::duration duration);
+
+        ImageDenoiser &denoiser;
+        BlobDetector detector;
+        std::vector<cv::Rect> boxes;
+        double averageDistance;
+        DurationStats durationStats;
+        std::atomic<int64_t> frameNanoseconds;
+};
+
+#endif // CONE_BRANCH_HPP
@@ -0,0 +1,304 @@
+#include "ConeColorKernel.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define CONE_COLOR_KERNEL_X86
+#include <immintrin.h>
+#endif
+
+namespace {
+
+// Fixed point precision used by OpenCV for the 8-bit BGR to HSV conversion
+const int HSV_SHIFT = 12;
+const int HSV_ROUND = 1 << (HSV_SHIFT - 1);
+// 8-bit hue is stored in the range [0, 180)
+const int HUE_RANGE = 180;
+
+// Division tables of OpenCV's 8-bit BGR to HSV conversion; using the same tables keeps the masks bit-identical
+struct DivisionTables {
+    int32_t saturation[256];
+    int32_t hue[256];
+
+    DivisionTables() : saturation(), hue()
+    {
+        for (int i = 1; i < 256; i++)
+        {
+            saturation[i] = static_cast<int32_t>(std::lround((255 << HSV_SHIFT) / (1.0 * i)));
+            hue[i] = static_cast<int32_t>(std::lround((HUE_RANGE << HSV_SHIFT) / (6.0 * i)));
+        }
+    }
+};
+
+const DivisionTables &divisionTables()
+{
+    static const DivisionTables tables;
+    return tables;
+}
+
+// Bounds outside [-1, 256] behave the same as -1 and 256 for 8-bit values, clamping them avoids overflows in the SIMD paths
+int32_t clampBound(int32_t bound)
+{
+    return std::min(256, std::max(-1, bound));
+}
+
+bool inRange(const HsvRange &range, int h, int s, int v)
+{
+    return range.low[0] <= h && h <= range.high[0] &&
+           range.low[1] <= s && s <= range.high[1] &&
+           range.low[2] <= v && v <= range.high[2];
+}
+
+void classifyScalar(const uint8_t *pixels, int channels, size_t begin, size_t count, const HsvRange &blue, const HsvRange &yellow,
+                    uint8_t *maskBlue, uint8_t *maskYellow)
+{
+    const DivisionTables &tables = divisionTables();
+
+    for (size_t i = begin; i < count; i++)
+    {
+        const uint8_t *pixel = pixels + i * static_cast<size_t>(channels);
+        int b = pixel[0];
+        int g = pixel[1];
+        int r = pixel[2];
+
+        int v = std::max(b, std::max(g, r));
+        int diff = v - std::min(b, std::min(g, r));
+        int s = (diff * tables.saturation[v] + HSV_ROUND) >> HSV_SHIFT;
+
+        // Select the hue sector without branches, the same way OpenCV does
+        int vr = (v == r) ? -1 : 0;
+        int vg = (v == g) ? -1 : 0;
+        int h = (vr & (g - b)) + (~vr & ((vg & (b - r + 2 * diff)) + (~vg & (r - g + 4 * diff))));
+        h = (h * tables.hue[diff] + HSV_ROUND) >> HSV_SHIFT;
+        h += (h < 0) ? HUE_RANGE : 0;
+
+        maskBlue[i] = inRange(blue, h, s, v) ? 255 : 0;
+        maskYellow[i] = inRange(yellow, h, s, v) ? 255 : 0;
+    }
+}
+
+#if defined(CONE_COLOR_KERNEL_X86)
+
+__attribute__((target("sse4.1"))) size_t classifySse41(const uint8_t *pixels, int channels, size_t count, const HsvRange &blue, const HsvRange &yellow,
+                                                       uint8_t *maskBlue, uint8_t *maskYellow)
+{
+    const DivisionTables &tables = divisionTables();
+
+    const __m128i byteMask = _mm_set1_epi32(0xff);
+    const __m128i round = _mm_set1_epi32(HSV_ROUND);
+    const __m128i hueRange = _mm_set1_epi32(HUE_RANGE);
+    const __m128i zero = _mm_setzero_si128();
+    // Spreads four packed BGR pixels into 32-bit lanes
+    const __m128i spreadBgr = _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+
+    // Store the bounds as (low - 1) and (high + 1) so that both comparisons are a signed greater-than
+    __m128i blueLow[3], blueHigh[3], yellowLow[3], yellowHigh[3];
+    for (int c = 0; c < 3; c++)
+    {
+        blueLow[c] = _mm_set1_epi32(clampBound(blue.low[c]) - 1);
+        blueHigh[c] = _mm_set1_epi32(clampBound(blue.high[c]) + 1);
+        yellowLow[c] = _mm_set1_epi32(clampBound(yellow.low[c]) - 1);
+        yellowHigh[c] = _mm_set1_epi32(clampBound(yellow.high[c]) + 1);
+    }
+
+    // A 16 byte load must stay inside the row, which needs 6 remaining BGR pixels or 4 remaining BGRA pixels
+    const size_t lookahead = (channels == 3) ? 6 : 4;
+
+    size_t i = 0;
+    for (; i + lookahead <= count; i += 4)
+    {
+        __m128i px = _mm_loadu_si128(reinterpret_cast<const __m128i *>(pixels + i * static_cast<size_t>(channels)));
+        if (channels == 3)
+        {
+            px = _mm_shuffle_epi8(px, spreadBgr);
+        }
+
+        __m128i b = _mm_and_si128(px, byteMask);
+        __m128i g = _mm_and_si128(_mm_srli_epi32(px, 8), byteMask);
+        __m128i r = _mm_and_si128(_mm_srli_epi32(px, 16), byteMask);
+
+        __m128i v = _mm_max_epi32(b, _mm_max_epi32(g, r));
+        __m128i diff = _mm_sub_epi32(v, _mm_min_epi32(b, _mm_min_epi32(g, r)));
+
+        // SSE has no gather, so the table entries are loaded lane by lane
+        __m128i saturationDiv = _mm_setr_epi32(tables.saturation[_mm_extract_epi32(v, 0)], tables.saturation[_mm_extract_epi32(v, 1)],
+                                               tables.saturation[_mm_extract_epi32(v, 2)], tables.saturation[_mm_extract_epi32(v, 3)]);
+        __m128i hueDiv = _mm_setr_epi32(tables.hue[_mm_extract_epi32(diff, 0)], tables.hue[_mm_extract_epi32(diff, 1)],
+                                        tables.hue[_mm_extract_epi32(diff, 2)], tables.hue[_mm_extract_epi32(diff, 3)]);
+
+        __m128i s = _mm_srai_epi32(_mm_add_epi32(_mm_mullo_epi32(diff, saturationDiv), round), HSV_SHIFT);
+
+        __m128i hueRed = _mm_sub_epi32(g, b);
+        __m128i hueGreen = _mm_add_epi32(_mm_sub_epi32(b, r), _mm_slli_epi32(diff, 1));
+        __m128i hueBlue = _mm_add_epi32(_mm_sub_epi32(r, g), _mm_slli_epi32(diff, 2));
+        __m128i h = _mm_blendv_epi8(hueBlue, hueGreen, _mm_cmpeq_epi32(v, g));
+        h = _mm_blendv_epi8(h, hueRed, _mm_cmpeq_epi32(v, r));
+        h = _mm_srai_epi32(_mm_add_epi32(_mm_mullo_epi32(h, hueDiv), round), HSV_SHIFT);
+        h = _mm_add_epi32(h, _mm_and_si128(_mm_cmpgt_epi32(zero, h), hueRange));
+
+        __m128i isBlue = _mm_and_si128(_mm_and_si128(_mm_cmpgt_epi32(h, blueLow[0]), _mm_cmpgt_epi32(blueHigh[0], h)),
+                                       _mm_and_si128(_mm_and_si128(_mm_cmpgt_epi32(s, blueLow[1]), _mm_cmpgt_epi32(blueHigh[1], s)),
+                                                     _mm_and_si128(_mm_cmpgt_epi32(v, blueLow[2]), _mm_cmpgt_epi32(blueHigh[2], v))));
+        __m128i isYellow = _mm_and_si128(_mm_and_si128(_mm_cmpgt_epi32(h, yellowLow[0]), _mm_cmpgt_epi32(yellowHigh[0], h)),
+                                         _mm_and_si128(_mm_and_si128(_mm_cmpgt_epi32(s, yellowLow[1]), _mm_cmpgt_epi32(yellowHigh[1], s)),
+                                                       _mm_and_si128(_mm_cmpgt_epi32(v, yellowLow[2]), _mm_cmpgt_epi32(yellowHigh[2], v))));
+
+        // Narrow the 0/-1 lanes down to 0/255 bytes
+        __m128i packed = _mm_packs_epi16(_mm_packs_epi32(isBlue, isYellow), zero);
+        int32_t blueBytes = _mm_cvtsi128_si32(packed);
+        int32_t yellowBytes = _mm_extract_epi32(packed, 1);
+        std::memcpy(maskBlue + i, &blueBytes, 4);
+        std::memcpy(maskYellow + i, &yellowBytes, 4);
+    }
+    return i;
+}
+
+__attribute__((target("avx2"))) size_t classifyAvx2(const uint8_t *pixels, int channels, size_t count, const HsvRange &blue, const HsvRange &yellow,
+                                                     uint8_t *maskBlue, uint8_t *maskYellow)
+{
+    const DivisionTables &tables = divisionTables();
+
+    const __m256i byteMask = _mm256_set1_epi32(0xff);
+    const __m256i round = _mm256_set1_epi32(HSV_ROUND);
+    const __m256i hueRange = _mm256_set1_epi32(HUE_RANGE);
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i offsetsBgr = _mm256_setr_epi32(0, 3, 6, 9, 12, 15, 18, 21);
+
+    // Store the bounds as (low - 1) and (high + 1) so that both comparisons are a signed greater-than
+    __m256i blueLow[3], blueHigh[3], yellowLow[3], yellowHigh[3];
+    for (int c = 0; c < 3; c++)
+    {
+        blueLow[c] = _mm256_set1_epi32(clampBound(blue.low[c]) - 1);
+        blueHigh[c] = _mm256_set1_epi32(clampBound(blue.high[c]) + 1);
+        yellowLow[c] = _mm256_set1_epi32(clampBound(yellow.low[c]) - 1);
+        yellowHigh[c] = _mm256_set1_epi32(clampBound(yellow.high[c]) + 1);
+    }
+
+    // The gather of the last BGR pixel reads one byte past it, so one more pixel has to remain in the row
+    const size_t lookahead = (channels == 3) ? 9 : 8;
+
+    size_t i = 0;
+    for (; i + lookahead <= count; i += 8)
+    {
+        const uint8_t *block = pixels + i * static_cast<size_t>(channels);
+        __m256i px = (channels == 3) ? _mm256_i32gather_epi32(reinterpret_cast<const int *>(block), offsetsBgr, 1)
+                                     : _mm256_loadu_si256(reinterpret_cast<const __m256i *>(block));
+
+        __m256i b = _mm256_and_si256(px, byteMask);
+        __m256i g = _mm256_and_si256(_mm256_srli_epi32(px, 8), byteMask);
+        __m256i r = _mm256_and_si256(_mm256_srli_epi32(px, 16), byteMask);
+
+        __m256i v = _mm256_max_epi32(b, _mm256_max_epi32(g, r));
+        __m256i diff = _mm256_sub_epi32(v, _mm256_min_epi32(b, _mm256_min_epi32(g, r)));
+
+        __m256i saturationDiv = _mm256_i32gather_epi32(tables.saturation, v, 4);
+        __m256i hueDiv = _mm256_i32gather_epi32(tables.hue, diff, 4);
+
+        __m256i s = _mm256_srai_epi32(_mm256_add_epi32(_mm256_mullo_epi32(diff, saturationDiv), round), HSV_SHIFT);
+
+        __m256i hueRed = _mm256_sub_epi32(g, b);
+        __m256i hueGreen = _mm256_add_epi32(_mm256_sub_epi32(b, r), _mm256_slli_epi32(diff, 1));
+        __m256i hueBlue = _mm256_add_epi32(_mm256_sub_epi32(r, g), _mm256_slli_epi32(diff, 2));
+        __m256i h = _mm256_blendv_epi8(hueBlue, hueGreen, _mm256_cmpeq_epi32(v, g));
+        h = _mm256_blendv_epi8(h, hueRed, _mm256_cmpeq_epi32(v, r));
+        h = _mm256_srai_epi32(_mm256_add_epi32(_mm256_mullo_epi32(h, hueDiv), round), HSV_SHIFT);
+        h = _mm256_add_epi32(h, _mm256_and_si256(_mm256_cmpgt_epi32(zero, h), hueRange));
+
+        __m256i isBlue = _mm256_and_si256(_mm256_and_si256(_mm256_cmpgt_epi32(h, blueLow[0]), _mm256_cmpgt_epi32(blueHigh[0], h)),
+                                          _mm256_and_si256(_mm256_and_si256(_mm256_cmpgt_epi32(s, blueLow[1]), _mm256_cmpgt_epi32(blueHigh[1], s)),
+                                                           _mm256_and_si256(_mm256_cmpgt_epi32(v, blueLow[2]), _mm256_cmpgt_epi32(blueHigh[2], v))));
+        __m256i isYellow = _mm256_and_si256(_mm256_and_si256(_mm256_cmpgt_epi32(h, yellowLow[0]), _mm256_cmpgt_epi32(yellowHigh[0], h)),
+                                            _mm256_and_si256(_mm256_and_si256(_mm256_cmpgt_epi32(s, yellowLow[1]), _mm256_cmpgt_epi32(yellowHigh[1], s)),
+                                                             _mm256_and_si256(_mm256_cmpgt_epi32(v, yellowLow[2]), _mm256_cmpgt_epi32(yellowHigh[2], v))));
+
+        // Narrow the 0/-1 lanes down to 0/255 bytes; every 128-bit lane then holds four blue and four yellow bytes
+        __m256i packed = _mm256_packs_epi16(_mm256_packs_epi32(isBlue, isYellow), zero);
+        __m128i low = _mm256_castsi256_si128(packed);
+        __m128i high = _mm256_extracti128_si256(packed, 1);
+        _mm_storel_epi64(reinterpret_cast<__m128i *>(maskBlue + i), _mm_unpacklo_epi32(low, high));
+        _mm_storel_epi64(reinterpret_cast<__m128i *>(maskYellow + i), _mm_unpacklo_epi32(_mm_srli_si128(low, 4), _mm_srli_si128(high, 4)));
+    }
+    return i;
+}
+
+#endif
+
+ConeColorKernel::Isa detectIsa()
+{
+#if defined(CONE_COLOR_KERNEL_X86)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+    {
+        return ConeColorKernel::Isa::AVX2;
+    }
+    if (__builtin_cpu_supports("sse4.1"))
+    {
+        return ConeColorKernel::Isa::SSE41;
+    }
+#endif
+    return ConeColorKernel::Isa::SCALAR;
+}
+
+} // namespace
+
+void ConeColorKernel::classify(const uint8_t *pixels, int channels, size_t count, const HsvRange &blue, const HsvRange &yellow,
+                               uint8_t *maskBlue, uint8_t *maskYellow, Isa isa)
+{
+    static const Isa bestIsa = detectIsa();
+    if (isa == Isa::AUTO || !isSupported(isa))
+    {
+        isa = bestIsa;
+    }
+
+    size_t done = 0;
+#if defined(CONE_COLOR_KERNEL_X86)
+    if (isa == Isa::AVX2)
+    {
+        done = classifyAvx2(pixels, channels, count, blue, yellow, maskBlue, maskYellow);
+    }
+    else if (isa == Isa::SSE41)
+    {
+        done = classifySse41(pixels, channels, count, blue, yellow, maskBlue, maskYellow);
+    }
+#endif
+
+    // The scalar path handles the pixels at the end of the row that do not fill a whole vector
+    classifyScalar(pixels, channels, done, count, blue, yellow, maskBlue, maskYellow);
+}
+
+bool ConeColorKernel::isSupported(Isa isa)
+{
+    switch (isa)
+    {
+    case Isa::AUTO:
+    case Isa::SCALAR:
+        return true;
+#if defined(CONE_COLOR_KERNEL_X86)
+    case Isa::SSE41:
+        return __builtin_cpu_supports("sse4.1") || __builtin_cpu_supports("avx2");
+    case Isa::AVX2:
+        return __builtin_cpu_supports("avx2");
+#endif
+    default:
+        return false;
+    }
+}
+
+const char *ConeColorKernel::name(Isa isa)
+{
+    switch (isa)
+    {
+    case Isa::AUTO:
+        return "auto";
+    case Isa::SCALAR:
+        return "scalar";
+    case Isa::SSE41:
+        return "sse4.1";
+    case Isa::AVX2:
+        return "avx2";
+    default:
+        return "unknown";
+    }
+}
@@ -0,0 +1,31 @@
+#ifndef CONE_COLOR_KERNEL_HPP
+#define CONE_COLOR_KERNEL_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+// Inclusive HSV bounds of one cone color, with the same meaning as the bounds of cv::inRange
+struct HsvRange {
+    int32_t low[3];
+    int32_t high[3];
+};
+
+// Converts BGR(A) pixels to HSV on the fly and writes the blue and yellow masks in a single pass,
+// the HSV values are never stored in memory
+class ConeColorKernel {
+    public:
+        enum class Isa {
+            AUTO,
+            SCALAR,
+            SSE41,
+            AVX2
+        };
+
+        static void classify(const uint8_t *pixels, int channels, size_t count, const HsvRange &blue, const HsvRange &yellow,
+                             uint8_t *maskBlue, uint8_t *maskYellow, Isa isa = Isa::AUTO);
+
+        static bool isSupported(Isa isa);
+        static const char *name(Isa isa);
+};
+
+#endif // CONE_COLOR_KERNEL_HPP
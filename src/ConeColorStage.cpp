@@ -0,0 +1,130 @@
+#include "ConeColorStage.hpp"
+#include <opencv2/imgproc.hpp>
+
+ConeColorStage::ConeColorStage(Mode stageMode)
+    : mode(stageMode), blueLow(), blueHigh(), yellowLow(), yellowHigh(), blueRange(), yellowRange(), hsvImage(), colorLut(), colorLutOutdated(true)
+{
+}
+
+void ConeColorStage::setBlueRange(const cv::Scalar &low, const cv::Scalar &high)
+{
+    blueLow = low;
+    blueHigh = high;
+    blueRange = toHsvRange(low, high);
+    colorLutOutdated = true;
+}
+
+void ConeColorStage::setYellowRange(const cv::Scalar &low, const cv::Scalar &high)
+{
+    yellowLow = low;
+    yellowHigh = high;
+    yellowRange = toHsvRange(low, high);
+    colorLutOutdated = true;
+}
+
+void ConeColorStage::process(const cv::Mat &imageROI, cv::Mat &maskBlue, cv::Mat &maskYellow)
+{
+    prepare(imageROI, maskBlue, maskYellow);
+    processRows(imageROI, maskBlue, maskYellow, 0, imageROI.rows);
+}
+
+void ConeColorStage::prepare(const cv::Mat &imageROI, cv::Mat &maskBlue, cv::Mat &maskYellow)
+{
+    maskBlue.create(imageROI.size(), CV_8U);
+    maskYellow.create(imageROI.size(), CV_8U);
+
+    if (mode == Mode::OPENCV)
+    {
+        hsvImage.create(imageROI.size(), CV_8UC3);
+    }
+
+    // Rebuild the table only after the bounds were changed
+    if (mode == Mode::LUT && colorLutOutdated)
+    {
+        colorLut.build(blueRange, yellowRange);
+        colorLutOutdated = false;
+    }
+}
+
+void ConeColorStage::processRows(const cv::Mat &imageROI, cv::Mat &maskBlue, cv::Mat &maskYellow, int firstRow, int lastRow)
+{
+    if (mode == Mode::OPENCV)
+    {
+        // Views of the rows, the OpenCV functions write into the allocated buffers as the sizes match
+        cv::Mat hsvRows = hsvImage.rowRange(firstRow, lastRow);
+        cv::Mat blueRows = maskBlue.rowRange(firstRow, lastRow);
+        cv::Mat yellowRows = maskYellow.rowRange(firstRow, lastRow);
+
+        // Convert the region of interest into HSV only once for both colors
+        cv::cvtColor(imageROI.rowRange(firstRow, lastRow), hsvRows, cv::COLOR_BGR2HSV);
+
+        // Get pixels that are in range for blue and yellow cones from the same HSV buffer
+        cv::inRange(hsvRows, blueLow, blueHigh, blueRows);
+        cv::inRange(hsvRows, yellowLow, yellowHigh, yellowRows);
+        return;
+    }
+
+    if (mode == Mode::LUT)
+    {
+        for (int y = firstRow; y < lastRow; y++)
+        {
+            colorLut.classify(imageROI.ptr<uint8_t>(y), imageROI.channels(), static_cast<size_t>(imageROI.cols), maskBlue.ptr<uint8_t>(y), maskYellow.ptr<uint8_t>(y));
+        }
+        return;
+    }
+
+    // Convert and classify row by row, as the ROI does not have to be continuous
+    for (int y = firstRow; y < lastRow; y++)
+    {
+        ConeColorKernel::classify(imageROI.ptr<uint8_t>(y), imageROI.channels(), static_cast<size_t>(imageROI.cols), blueRange, yellowRange,
+                                  maskBlue.ptr<uint8_t>(y), maskYellow.ptr<uint8_t>(y));
+    }
+}
+
+ConeColorStage::Mode ConeColorStage::getMode() const
+{
+    return mode;
+}
+
+const cv::Mat &ConeColorStage::getHsvImage() const
+{
+    return hsvImage;
+}
+
+const ColorLUT &ConeColorStage::getColorLut() const
+{
+    return colorLut;
+}
+
+bool ConeColorStage::parseMode(const std::string &name, Mode &stageMode)
+{
+    if (name == "opencv")
+    {
+        stageMode = Mode::OPENCV;
+    }
+    else if (name == "fused")
+    {
+        stageMode = Mode::FUSED;
+    }
+    else if (name == "lut")
+    {
+        stageMode = Mode::LUT;
+    }
+    else
+    {
+        return false;
+    }
+    return true;
+}
+
+HsvRange ConeColorStage::toHsvRange(const cv::Scalar &low, const cv::Scalar &high)
+{
+    // cv::inRange rounds the bounds to integers in the same way
+    HsvRange range;
+    for (int c = 0; c < 3; c++)
+    {
+        range.low[c] = cvRound(low[c]);
+        range.high[c] = cvRound(high[c]);
+    }
+    return range;
+}
@@ -0,0 +1,61 @@
+#ifndef CONE_COLOR_STAGE_HPP
+#define CONE_COLOR_STAGE_HPP
+
+#include <opencv2/core.hpp>
+#include <string>
+
+#include "ColorLUT.hpp"
+#include "ConeColorKernel.hpp"
+
+// Classifies the region of interest into the blue and yellow cone masks
+class ConeColorStage {
+    public:
+        enum class Mode {
+            // cv::cvtColor once into a shared HSV buffer, followed by cv::inRange per color
+            OPENCV,
+            // ConeColorKernel converts and classifies in a single pass without an HSV buffer
+            FUSED,
+            // ColorLUT classifies with one table lookup per pixel, the table is rebuilt when a bound changes
+            LUT
+        };
+
+        explicit ConeColorStage(Mode stageMode = Mode::FUSED);
+
+        void setBlueRange(const cv::Scalar &low, const cv::Scalar &high);
+        void setYellowRange(const cv::Scalar &low, const cv::Scalar &high);
+
+        void process(const cv::Mat &imageROI, cv::Mat &maskBlue, cv::Mat &maskYellow);
+
+        // Same as process, split for strips of rows on several threads: prepare allocates the masks and rebuilds the
+        // lookup table once per frame, then processRows may run for disjoint row ranges at the same time
+        void prepare(const cv::Mat &imageROI, cv::Mat &maskBlue, cv::Mat &maskYellow);
+        void processRows(const cv::Mat &imageROI, cv::Mat &maskBlue, cv::Mat &maskYellow, int firstRow, int lastRow);
+
+        Mode getMode() const;
+        const cv::Mat &getHsvImage() const;
+        const ColorLUT &getColorLut() const;
+
+        static bool parseMode(const std::string &name, Mode &stageMode);
+
+    private:
+        static HsvRange toHsvRange(const cv::Scalar &low, const cv::Scalar &high);
+
+        Mode mode;
+
+        cv::Scalar blueLow;
+        cv::Scalar blueHigh;
+        cv::Scalar yellowLow;
+        cv::Scalar yellowHigh;
+
+        // The same bounds rounded to integers for the fused kernel
+        HsvRange blueRange;
+        HsvRange yellowRange;
+
+        // HSV buffer shared by both classifiers, reused between frames
+        cv::Mat hsvImage;
+
+        ColorLUT colorLut;
+        bool colorLutOutdated;
+};
+
+#endif // CONE_COLOR_STAGE_HPP
@@ -0,0 +1,135 @@
+#include "ConeDetector.hpp"
+
+#include <chrono>
+#include <initializer_list>
+
+ConeDetector::ConeDetector(ConeColorStage::Mode colorMode, ImageDenoiser::Mode denoiseMode, BlobDetector::Mode blobMode)
+    : coneColorStage(colorMode), workspace(denoiseMode), blueBranch("blue branch", workspace.denoiserBlue, blobMode),
+      yellowBranch("yellow branch", workspace.denoiserYellow, blobMode), roi(), imageCenter(), colorStrips(1),
+      blueThreshold(0), blueMaxValue(0), yellowThreshold(0), yellowMaxValue(0), colorStats("color stage"),
+      denoiseStats("denoising"), blobStats("blob detection")
+{
+    // Skip really small rectangles, and the yellow rectangles in the middle and at the bottom of the frame
+    blueBranch.setFilter([](const cv::Rect &rect) {
+        return rect.area() > 100;
+    });
+    yellowBranch.setFilter([](const cv::Rect &rect) {
+        return rect.area() > 100 && rect.y + ROI_TOP < 450 && (rect.x > 390 || rect.x < 340);
+    });
+
+    const ConeColorSettings defaults;
+    setColorRanges(defaults);
+    setThresholds(defaults);
+}
+
+void ConeDetector::allocate(uint32_t width, uint32_t height, size_t threads)
+{
+    roi = cv::Rect(0, ROI_TOP, static_cast<int>(width), static_cast<int>(height) - ROI_TOP);
+    imageCenter = cv::Point(static_cast<int>(width / 2), static_cast<int>(height));
+    colorStrips = threads;
+    workspace.allocate(width, height, roi, threads);
+}
+
+void ConeDetector::setColorRanges(const ConeColorSettings &settings)
+{
+    coneColorStage.setBlueRange(settings.blueLow, settings.blueHigh);
+    coneColorStage.setYellowRange(settings.yellowLow, settings.yellowHigh);
+}
+
+void ConeDetector::setThresholds(const ConeColorSettings &settings)
+{
+    blueThreshold = settings.blueThreshold;
+    blueMaxValue = settings.blueMaxValue;
+    yellowThreshold = settings.yellowThreshold;
+    yellowMaxValue = settings.yellowMaxValue;
+}
+
+void ConeDetector::classifyAndDenoise(const cv::Mat &imageROI, cv::Mat &maskBlue, cv::Mat &maskYellow, cv::Mat &processedBlue,
+                                      cv::Mat &processedYellow, WorkerPool &pool)
+{
+    // Get pixels that are in range for blue and yellow cones, one strip of rows per thread
+    auto colorStart = std::chrono::steady_clock::now();
+    coneColorStage.prepare(imageROI, maskBlue, maskYellow);
+    pool.run(colorStrips, [&](size_t strip) {
+        const int firstRow = static_cast<int>(static_cast<size_t>(imageROI.rows) * strip / colorStrips);
+        const int lastRow = static_cast<int>(static_cast<size_t>(imageROI.rows) * (strip + 1) / colorStrips);
+        coneColorStage.processRows(imageROI, maskBlue, maskYellow, firstRow, lastRow);
+    });
+    colorStats.add(std::chrono::steady_clock::now() - colorStart);
+
+    // Denoise the strips of both masks
+    auto denoiseStart = std::chrono::steady_clock::now();
+    const size_t blueStrips = blueBranch.getStripCount();
+    const size_t yellowStrips = yellowBranch.getStripCount();
+    pool.run(blueStrips + yellowStrips, [&](size_t task) {
+        if (task < blueStrips)
+        {
+            blueBranch.denoiseStrip(imageROI, maskBlue, processedBlue, blueThreshold, blueMaxValue, task);
+        }
+        else
+        {
+            yellowBranch.denoiseStrip(imageROI, maskYellow, processedYellow, yellowThreshold, yellowMaxValue, task - blueStrips);
+        }
+    });
+    denoiseStats.add(std::chrono::steady_clock::now() - denoiseStart);
+}
+
+void ConeDetector::findCones(const cv::Mat &processedBlue, const cv::Mat &processedYellow, WorkerPool &pool,
+                             std::vector<cv::Rect> &boxesBlue, std::vector<cv::Rect> &boxesYellow)
+{
+    auto blobStart = std::chrono::steady_clock::now();
+    pool.run(2, [&](size_t branch) {
+        if (branch == 0)
+        {
+            blueBranch.detect(processedBlue, ROI_TOP, imageCenter);
+        }
+        else
+        {
+            yellowBranch.detect(processedYellow, ROI_TOP, imageCenter);
+        }
+    });
+    blueBranch.finishFrame();
+    yellowBranch.finishFrame();
+    boxesBlue = blueBranch.getBoxes();
+    boxesYellow = yellowBranch.getBoxes();
+    blobStats.add(std::chrono::steady_clock::now() - blobStart);
+}
+
+void ConeDetector::printStats(std::ostream &out)
+{
+    // The slower branch is the critical path when they run in parallel
+    colorStats.print(out);
+    colorStats.reset();
+    out << "; ";
+    for (ConeBranch *branch : {&blueBranch, &yellowBranch})
+    {
+        branch->getDurationStats().print(out);
+        branch->getDurationStats().reset();
+        out << "; ";
+    }
+    denoiseStats.print(out);
+    denoiseStats.reset();
+    out << "; ";
+    blobStats.print(out);
+    blobStats.reset();
+}
+
+size_t ConeDetector::getFrameCount() const
+{
+    return blobStats.getCount();
+}
+
+const cv::Rect &ConeDetector::getRoi() const
+{
+    return roi;
+}
+
+const cv::Point &ConeDetector::getImageCenter() const
+{
+    return imageCenter;
+}
+
+FrameWorkspace &ConeDetector::getWorkspace()
+{
+    return workspace;
+}
@@ -0,0 +1,88 @@
+#ifndef CONE_DETECTOR_HPP
+#define CONE_DETECTOR_HPP
+
+#include <opencv2/core.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+#include "BlobDetector.hpp"
+#include "ConeBranch.hpp"
+#include "ConeColorStage.hpp"
+#include "DurationStats.hpp"
+#include "FrameWorkspace.hpp"
+#include "ImageDenoiser.hpp"
+#include "WorkerPool.hpp"
+
+// HSV bounds and denoising thresholds of both cone colors, the defaults are the values that were tuned on the
+// recordings
+struct ConeColorSettings {
+    cv::Scalar blueLow{109, 68, 42};
+    cv::Scalar blueHigh{135, 250, 120};
+    cv::Scalar yellowLow{11, 20, 128};
+    cv::Scalar yellowHigh{54, 198, 232};
+    int blueThreshold{30};
+    int blueMaxValue{255};
+    int yellowThreshold{30};
+    int yellowMaxValue{255};
+};
+
+// Finds the blue and yellow cones of a frame: color classification of the region of interest, denoising of both masks
+// and blob detection per color. Every detector owns its stages and its workspace, so several detectors can process
+// different frames at the same time.
+class ConeDetector {
+    public:
+        ConeDetector(ConeColorStage::Mode colorMode, ImageDenoiser::Mode denoiseMode, BlobDetector::Mode blobMode);
+
+        ConeDetector(const ConeDetector &) = delete;
+        ConeDetector &operator=(const ConeDetector &) = delete;
+
+        // Allocates the workspace for the frame size, the pixel stages are split into one strip of rows per thread
+        void allocate(uint32_t width, uint32_t height, size_t threads);
+
+        void setColorRanges(const ConeColorSettings &settings);
+        void setThresholds(const ConeColorSettings &settings);
+
+        // Classifies the pixels of the region of interest and denoises both masks, the strips run on the pool
+        void classifyAndDenoise(const cv::Mat &imageROI, cv::Mat &maskBlue, cv::Mat &maskYellow, cv::Mat &processedBlue,
+                                cv::Mat &processedYellow, WorkerPool &pool);
+
+        // Finds the cones per color in the denoised masks and copies their boxes, which are in frame coordinates
+        void findCones(const cv::Mat &processedBlue, const cv::Mat &processedYellow, WorkerPool &pool,
+                       std::vector<cv::Rect> &boxesBlue, std::vector<cv::Rect> &boxesYellow);
+
+        // Prints and resets the time of the color stage, of each branch, of the denoising and of the blob detection
+        void printStats(std::ostream &out);
+        // Frames since the last printStats
+        size_t getFrameCount() const;
+
+        const cv::Rect &getRoi() const;
+        const cv::Point &getImageCenter() const;
+        FrameWorkspace &getWorkspace();
+
+        // The region of interest is the bottom part of the frame from this row on
+        static const int ROI_TOP = 230;
+
+    private:
+        ConeColorStage coneColorStage;
+        FrameWorkspace workspace;
+        ConeBranch blueBranch;
+        ConeBranch yellowBranch;
+
+        cv::Rect roi;
+        cv::Point imageCenter;
+        size_t colorStrips;
+
+        int blueThreshold;
+        int blueMaxValue;
+        int yellowThreshold;
+        int yellowMaxValue;
+
+        DurationStats colorStats;
+        DurationStats denoiseStats;
+        DurationStats blobStats;
+};
+
+#endif // CONE_DETECTOR_HPP
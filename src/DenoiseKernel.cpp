@@ -0,0 +1,335 @@
+#include "DenoiseKernel.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+// OpenCV uses these tables for GaussianBlur with sigma 0, as fixed point numbers with 8 fractional bits
+const uint32_t GAUSSIAN_3[] = {64, 128, 64};
+const uint32_t GAUSSIAN_5[] = {16, 64, 96, 64, 16};
+const uint32_t GAUSSIAN_7[] = {8, 28, 56, 72, 56, 28, 8};
+
+// Both passes of the blur add 8 fractional bits, the result is rounded half up like OpenCV does
+const int BLUR_SHIFT = 16;
+const uint32_t BLUR_ROUND = 1u << (BLUR_SHIFT - 1);
+
+// Fixed point coefficients of OpenCV's 8-bit BGR to gray conversion
+const int GRAY_SHIFT = 15;
+const uint32_t GRAY_B = 3735;
+const uint32_t GRAY_G = 19235;
+const uint32_t GRAY_R = 9798;
+const uint32_t GRAY_ROUND = 1u << (GRAY_SHIFT - 1);
+
+// Row index with the BORDER_REFLECT_101 border of GaussianBlur
+inline int reflect(int y, int size)
+{
+    if (y < 0)
+    {
+        return -y;
+    }
+    if (y >= size)
+    {
+        return 2 * size - 2 - y;
+    }
+    return y;
+}
+
+// True if all bytes of the row are 0, the bytes are combined 8 at a time
+bool isEmpty(const uint8_t *row, size_t count)
+{
+    uint64_t combined = 0;
+    size_t x = 0;
+    for (; x + 8 <= count; x += 8)
+    {
+        uint64_t word;
+        std::memcpy(&word, row + x, 8);
+        combined |= word;
+    }
+    for (; x < count; x++)
+    {
+        combined |= row[x];
+    }
+    return combined == 0;
+}
+
+// Only the pixels that pass the mask test are converted to gray, the others are black before the threshold
+template <bool NONZERO>
+void thresholdPixels(const uint8_t *closed, const uint8_t *ignore, const uint8_t *pixels, size_t channels, size_t count,
+                     int thresholdValue, uint8_t maxValue, uint8_t *output)
+{
+    for (size_t x = 0; x < count; x++)
+    {
+        const bool passes = NONZERO ? (closed[x] != 0 && ignore[x] != 0) : ((closed[x] & ignore[x]) != 0);
+        int gray = 0;
+        if (passes)
+        {
+            const uint8_t *pixel = pixels + x * channels;
+            gray = static_cast<int>((GRAY_B * pixel[0] + GRAY_G * pixel[1] + GRAY_R * pixel[2] + GRAY_ROUND) >> GRAY_SHIFT);
+        }
+        output[x] = (gray > thresholdValue) ? maxValue : 0;
+    }
+}
+
+} // namespace
+
+DenoiseKernel::DenoiseKernel()
+    : width(0), height(0), radius(0), stripRows(0), weights(), rowSums(), blurred(), dilated(), paddedRow(), columnRow(), columnSums(), sumsUsed(), blurredUsed(), dilatedUsed()
+{
+}
+
+bool DenoiseKernel::isSupported(int imageWidth, int imageHeight, int kernelSize)
+{
+    return (kernelSize == 3 || kernelSize == 5 || kernelSize == 7) && imageWidth >= kernelSize && imageHeight >= kernelSize;
+}
+
+void DenoiseKernel::configure(int imageWidth, int imageHeight, int kernelSize, int rows)
+{
+    width = imageWidth;
+    height = imageHeight;
+    radius = kernelSize / 2;
+
+    if (kernelSize == 3)
+    {
+        weights.assign(GAUSSIAN_3, GAUSSIAN_3 + 3);
+    }
+    else if (kernelSize == 5)
+    {
+        weights.assign(GAUSSIAN_5, GAUSSIAN_5 + 5);
+    }
+    else
+    {
+        weights.assign(GAUSSIAN_7, GAUSSIAN_7 + 7);
+    }
+
+    // A strip row keeps one row of sums (2 bytes per pixel), one blurred and one dilated row
+    if (rows <= 0)
+    {
+        rows = static_cast<int>(CACHE_BUDGET / (4 * static_cast<size_t>(width))) - 6 * radius;
+    }
+    stripRows = std::min(height, std::max(8, rows));
+
+    const size_t w = static_cast<size_t>(width);
+    rowSums.assign(static_cast<size_t>(stripRows + 6 * radius) * w, 0);
+    blurred.assign(static_cast<size_t>(stripRows + 4 * radius) * w, 0);
+    dilated.assign(static_cast<size_t>(stripRows + 2 * radius) * w, 0);
+    paddedRow.assign(w + 2 * static_cast<size_t>(radius), 0);
+    columnRow.assign(w, 0);
+    columnSums.assign(w, 0);
+    sumsUsed.assign(static_cast<size_t>(stripRows + 6 * radius), false);
+    blurredUsed.assign(static_cast<size_t>(stripRows + 4 * radius), false);
+    dilatedUsed.assign(static_cast<size_t>(stripRows + 2 * radius), false);
+}
+
+int DenoiseKernel::getStripRows() const
+{
+    return stripRows;
+}
+
+void DenoiseKernel::run(const DenoiseImages &images, int thresholdValue, int maxValue, int firstRow, int lastRow)
+{
+    // cv::threshold saturates the maximum value to the 8-bit range
+    const uint8_t maxByte = static_cast<uint8_t>(std::min(255, std::max(0, maxValue)));
+
+    for (int y = firstRow; y < lastRow; y += stripRows)
+    {
+        runStrip(images, thresholdValue, maxByte, y, std::min(lastRow, y + stripRows));
+    }
+}
+
+void DenoiseKernel::runStrip(const DenoiseImages &images, int thresholdValue, uint8_t maxValue, int firstRow, int lastRow)
+{
+    const int r = radius;
+    const int k = 2 * r + 1;
+    const size_t w = static_cast<size_t>(width);
+
+    // Rows of the dilated mask, the blurred mask and the input mask that the output rows depend on
+    const int dilatedFirst = std::max(0, firstRow - r);
+    const int dilatedLast = std::min(height, lastRow + r);
+    const int blurredFirst = std::max(0, dilatedFirst - r);
+    const int blurredLast = std::min(height, dilatedLast + r);
+    const int sumsFirst = std::max(0, blurredFirst - r);
+    const int sumsLast = std::min(height, blurredLast + r);
+
+    // Horizontal pass of the Gaussian blur, the reflected border is copied next to the row first.
+    // Cone masks are mostly empty, so empty rows are only flagged and skipped by all later passes.
+    uint8_t *__restrict padded = paddedRow.data();
+    for (int y = sumsFirst; y < sumsLast; y++)
+    {
+        const uint8_t *mask = images.mask + static_cast<size_t>(y) * images.maskStep;
+        sumsUsed[static_cast<size_t>(y - sumsFirst)] = !isEmpty(mask, w);
+        if (!sumsUsed[static_cast<size_t>(y - sumsFirst)])
+        {
+            continue;
+        }
+
+        std::copy_n(mask, w, padded + r);
+        for (int i = 1; i <= r; i++)
+        {
+            padded[r - i] = mask[i];
+            padded[r + width - 1 + i] = mask[width - 1 - i];
+        }
+
+        // The sums stay below 255 * 256, so they fit into 16 bits
+        uint16_t *__restrict sums = &rowSums[static_cast<size_t>(y - sumsFirst) * w];
+        const uint16_t firstWeight = static_cast<uint16_t>(weights[0]);
+        for (size_t x = 0; x < w; x++)
+        {
+            sums[x] = static_cast<uint16_t>(firstWeight * padded[x]);
+        }
+        for (int i = 1; i < k; i++)
+        {
+            const uint16_t weight = static_cast<uint16_t>(weights[static_cast<size_t>(i)]);
+            const uint8_t *__restrict shifted = padded + i;
+            for (size_t x = 0; x < w; x++)
+            {
+                sums[x] = static_cast<uint16_t>(sums[x] + weight * shifted[x]);
+            }
+        }
+    }
+
+    // Vertical pass of the Gaussian blur
+    uint32_t *__restrict accumulator = columnSums.data();
+    for (int y = blurredFirst; y < blurredLast; y++)
+    {
+        bool used = false;
+        for (int i = 0; i < k; i++)
+        {
+            const int row = reflect(y + i - r, height);
+            if (!sumsUsed[static_cast<size_t>(row - sumsFirst)])
+            {
+                continue;
+            }
+
+            const uint32_t weight = weights[static_cast<size_t>(i)];
+            const uint16_t *__restrict sums = &rowSums[static_cast<size_t>(row - sumsFirst) * w];
+            if (!used)
+            {
+                for (size_t x = 0; x < w; x++)
+                {
+                    accumulator[x] = BLUR_ROUND + weight * sums[x];
+                }
+                used = true;
+                continue;
+            }
+            for (size_t x = 0; x < w; x++)
+            {
+                accumulator[x] += weight * sums[x];
+            }
+        }
+
+        blurredUsed[static_cast<size_t>(y - blurredFirst)] = used;
+        if (used)
+        {
+            uint8_t *__restrict blurredRow = &blurred[static_cast<size_t>(y - blurredFirst) * w];
+            for (size_t x = 0; x < w; x++)
+            {
+                blurredRow[x] = static_cast<uint8_t>(accumulator[x] >> BLUR_SHIFT);
+            }
+        }
+    }
+
+    // Dilation of the closing, the rectangle is clipped at the border of the image like in cv::morphologyEx.
+    // 0 on both sides of the row never wins the maximum.
+    uint8_t *__restrict column = columnRow.data();
+    std::fill(paddedRow.begin(), paddedRow.end(), 0);
+    for (int y = dilatedFirst; y < dilatedLast; y++)
+    {
+        bool used = false;
+        for (int row = std::max(0, y - r); row <= std::min(height - 1, y + r); row++)
+        {
+            if (!blurredUsed[static_cast<size_t>(row - blurredFirst)])
+            {
+                continue;
+            }
+
+            const uint8_t *__restrict blurredRow = &blurred[static_cast<size_t>(row - blurredFirst) * w];
+            if (!used)
+            {
+                std::copy_n(blurredRow, w, column);
+                used = true;
+                continue;
+            }
+            for (size_t x = 0; x < w; x++)
+            {
+                column[x] = std::max(column[x], blurredRow[x]);
+            }
+        }
+
+        dilatedUsed[static_cast<size_t>(y - dilatedFirst)] = used;
+        if (used)
+        {
+            std::copy_n(column, w, padded + r);
+            uint8_t *__restrict dilatedRow = &dilated[static_cast<size_t>(y - dilatedFirst) * w];
+            std::copy_n(padded, w, dilatedRow);
+            for (int i = 1; i < k; i++)
+            {
+                const uint8_t *__restrict shifted = padded + i;
+                for (size_t x = 0; x < w; x++)
+                {
+                    dilatedRow[x] = std::max(dilatedRow[x], shifted[x]);
+                }
+            }
+        }
+    }
+
+    // Erosion of the closing followed by the per-pixel steps, 255 on both sides of the row never wins the minimum
+    const uint8_t emptyValue = (0 > thresholdValue) ? maxValue : 0;
+    std::fill(paddedRow.begin(), paddedRow.end(), 255);
+    for (int y = firstRow; y < lastRow; y++)
+    {
+        uint8_t *__restrict output = images.output + static_cast<size_t>(y) * images.outputStep;
+
+        // A single empty row in the window erodes the whole row to 0
+        const int top = std::max(0, y - r);
+        const int bottom = std::min(height - 1, y + r);
+        bool used = true;
+        for (int row = top; row <= bottom; row++)
+        {
+            used = used && dilatedUsed[static_cast<size_t>(row - dilatedFirst)];
+        }
+        if (!used)
+        {
+            std::fill_n(output, w, emptyValue);
+            continue;
+        }
+
+        std::copy_n(&dilated[static_cast<size_t>(top - dilatedFirst) * w], w, column);
+        for (int row = top + 1; row <= bottom; row++)
+        {
+            const uint8_t *__restrict dilatedRow = &dilated[static_cast<size_t>(row - dilatedFirst) * w];
+            for (size_t x = 0; x < w; x++)
+            {
+                column[x] = std::min(column[x], dilatedRow[x]);
+            }
+        }
+
+        std::copy_n(column, w, padded + r);
+        std::copy_n(padded, w, output);
+        for (int i = 1; i < k; i++)
+        {
+            const uint8_t *__restrict shifted = padded + i;
+            for (size_t x = 0; x < w; x++)
+            {
+                output[x] = std::min(output[x], shifted[x]);
+            }
+        }
+
+        const uint8_t *ignore = images.ignoreMask + static_cast<size_t>(y) * images.ignoreStep;
+        const uint8_t *pixels = images.pixels + static_cast<size_t>(y) * images.pixelStep;
+        thresholdRow(output, ignore, pixels, images.channels, w, thresholdValue, maxValue, MaskTest::BITWISE, output);
+    }
+}
+
+void DenoiseKernel::thresholdRow(const uint8_t *closed, const uint8_t *ignore, const uint8_t *pixels, int channels, size_t count,
+                                 int thresholdValue, uint8_t maxValue, MaskTest test, uint8_t *output)
+{
+    if (test == MaskTest::NONZERO)
+    {
+        thresholdPixels<true>(closed, ignore, pixels, static_cast<size_t>(channels), count, thresholdValue, maxValue, output);
+    }
+    else
+    {
+        thresholdPixels<false>(closed, ignore, pixels, static_cast<size_t>(channels), count, thresholdValue, maxValue, output);
+    }
+}
@@ -0,0 +1,81 @@
+#ifndef DENOISE_KERNEL_HPP
+#define DENOISE_KERNEL_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Images read and written by DenoiseKernel, every step is in bytes
+struct DenoiseImages {
+    const uint8_t *mask{nullptr};
+    size_t maskStep{0};
+    const uint8_t *pixels{nullptr};
+    size_t pixelStep{0};
+    int channels{0};
+    const uint8_t *ignoreMask{nullptr};
+    size_t ignoreStep{0};
+    uint8_t *output{nullptr};
+    size_t outputStep{0};
+};
+
+// Fused version of the OpenCV denoise steps: Gaussian blur, closing, ignore mask, masking of the pixels, grayscale
+// conversion and threshold. The image is processed in strips of rows, and only the few rows of the blurred and dilated
+// mask that a strip needs are kept, so they stay in the cache. The masked color image and its gray version are never
+// stored, the gray value is computed only for the pixels that pass the mask.
+//
+// The output is bit-exact with the OpenCV functions: the 8-bit Gaussian blur and the grayscale conversion of OpenCV
+// use fixed point arithmetic, which is reproduced here with the same coefficients and rounding.
+class DenoiseKernel {
+    public:
+        // How the closed mask is combined with the ignore mask
+        enum class MaskTest {
+            // Bitwise AND like cv::bitwise_and, with an ignore mask of 1s only odd mask values pass
+            BITWISE,
+            // Every mask value other than 0 passes outside of the ignored region
+            NONZERO
+        };
+
+        DenoiseKernel();
+
+        // Kernel sizes with a fixed Gaussian table in OpenCV, the image has to be at least as large as the kernel
+        static bool isSupported(int width, int height, int kernelSize);
+
+        // Strip height 0 picks the largest strip whose intermediate rows fit into CACHE_BUDGET
+        void configure(int width, int height, int kernelSize, int stripRows = 0);
+        int getStripRows() const;
+
+        // Writes the output rows [firstRow, lastRow), the rows of the input around them are read as needed
+        void run(const DenoiseImages &images, int thresholdValue, int maxValue, int firstRow, int lastRow);
+
+        // Last step of the denoiser for one row: the pixels whose closed mask passes the test are converted to gray and
+        // thresholded, all other pixels are black. closed and output may be the same row.
+        static void thresholdRow(const uint8_t *closed, const uint8_t *ignore, const uint8_t *pixels, int channels, size_t count,
+                                 int thresholdValue, uint8_t maxValue, MaskTest test, uint8_t *output);
+
+        static const size_t CACHE_BUDGET = 128 * 1024;
+
+    private:
+        void runStrip(const DenoiseImages &images, int thresholdValue, uint8_t maxValue, int firstRow, int lastRow);
+
+        int width;
+        int height;
+        int radius;
+        int stripRows;
+        // Gaussian coefficients with 8 fractional bits
+        std::vector<uint32_t> weights;
+
+        // Horizontally blurred mask rows, blurred rows and dilated rows of one strip including the rows around it
+        std::vector<uint16_t> rowSums;
+        std::vector<uint8_t> blurred;
+        std::vector<uint8_t> dilated;
+        // One row with the border pixels on both sides, and one row for the vertical pass of the morphology
+        std::vector<uint8_t> paddedRow;
+        std::vector<uint8_t> columnRow;
+        std::vector<uint32_t> columnSums;
+        // Rows that are not entirely 0, empty rows are skipped by the following passes
+        std::vector<bool> sumsUsed;
+        std::vector<bool> blurredUsed;
+        std::vector<bool> dilatedUsed;
+};
+
+#endif // DENOISE_KERNEL_HPP
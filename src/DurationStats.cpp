@@ -0,0 +1,43 @@
+#include "DurationStats.hpp"
+
+#include <algorithm>
+
+DurationStats::DurationStats(const std::string &statsName)
+    : name(statsName), count(0), totalMicroseconds(0), maxMicroseconds(0)
+{
+}
+
+void DurationStats::add(std::chrono::steady_clock::duration duration)
+{
+    double microseconds = std::chrono::duration<double, std::micro>(duration).count();
+    count++;
+    totalMicroseconds += microseconds;
+    maxMicroseconds = std::max(maxMicroseconds, microseconds);
+}
+
+void DurationStats::reset()
+{
+    count = 0;
+    totalMicroseconds = 0;
+    maxMicroseconds = 0;
+}
+
+size_t DurationStats::getCount() const
+{
+    return count;
+}
+
+double DurationStats::getMeanMicroseconds() const
+{
+    return (count != 0) ? totalMicroseconds / static_cast<double>(count) : 0;
+}
+
+double DurationStats::getMaxMicroseconds() const
+{
+    return maxMicroseconds;
+}
+
+void DurationStats::print(std::ostream &out) const
+{
+    out << name << ": mean " << getMeanMicroseconds() << " us, max " << maxMicroseconds << " us over " << count << " frames";
+}
@@ -0,0 +1,30 @@
+#ifndef DURATION_STATS_HPP
+#define DURATION_STATS_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <ostream>
+#include <string>
+
+// Accumulates measured durations (e.g. how long the shared memory was locked) and reports their mean and maximum
+class DurationStats {
+    public:
+        explicit DurationStats(const std::string &statsName);
+
+        void add(std::chrono::steady_clock::duration duration);
+        void reset();
+
+        size_t getCount() const;
+        double getMeanMicroseconds() const;
+        double getMaxMicroseconds() const;
+
+        void print(std::ostream &out) const;
+
+    private:
+        std::string name;
+        size_t count;
+        double totalMicroseconds;
+        double maxMicroseconds;
+};
+
+#endif // DURATION_STATS_HPP
@@ -0,0 +1,274 @@
+#include "FrameCache.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <numeric>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// The values are written and read in the byte order of the machine, which is little endian on every target of the
+// microservice
+static const char MAGIC[8] = {'C', 'P', 'S', 'F', 'R', 'M', 'C', '\0'};
+static const uint32_t VERSION = 1;
+static const uint32_t CHANNELS = 3;
+static const size_t HEADER_SIZE = 56;
+
+FrameCacheWriter::FrameCacheWriter()
+    : file(nullptr), finalPath(), temporaryPath(), size(0), hash(0), width(0), height(0), offset(0), timestamps(), offsets()
+{
+}
+
+FrameCacheWriter::~FrameCacheWriter()
+{
+    discard();
+}
+
+bool FrameCacheWriter::create(const std::string &path, uint64_t recordingSize, uint64_t recordingHash)
+{
+    discard();
+
+    // Several evaluations of the same recording may build its cache at the same time, each one in its own file
+    std::vector<char> name(path.begin(), path.end());
+    const std::string suffix = ".XXXXXX";
+    name.insert(name.end(), suffix.begin(), suffix.end());
+    name.push_back('\0');
+    const int fd = ::mkstemp(name.data());
+    if (fd < 0)
+    {
+        return false;
+    }
+    ::fchmod(fd, 0644);
+    file = ::fdopen(fd, "wb");
+    if (file == nullptr)
+    {
+        ::close(fd);
+        ::unlink(name.data());
+        return false;
+    }
+    finalPath = path;
+    temporaryPath = name.data();
+    size = recordingSize;
+    hash = recordingHash;
+    width = 0;
+    height = 0;
+    timestamps.clear();
+    offsets.clear();
+
+    // The header is written by finish, the first frame starts at the first aligned offset after it
+    offset = FRAME_ALIGNMENT;
+    return std::fseek(file, static_cast<long>(offset), SEEK_SET) == 0;
+}
+
+bool FrameCacheWriter::append(int64_t sampleTimeStamp, const cv::Mat &frame)
+{
+    if (file == nullptr || frame.type() != CV_8UC3)
+    {
+        return false;
+    }
+    if (offsets.empty())
+    {
+        width = static_cast<uint32_t>(frame.cols);
+        height = static_cast<uint32_t>(frame.rows);
+    }
+    else if (frame.cols != static_cast<int>(width) || frame.rows != static_cast<int>(height))
+    {
+        return false;
+    }
+
+    const size_t rowBytes = static_cast<size_t>(frame.cols) * CHANNELS;
+    for (int row = 0; row < frame.rows; row++)
+    {
+        if (std::fwrite(frame.ptr<uint8_t>(row), 1, rowBytes, file) != rowBytes)
+        {
+            return false;
+        }
+    }
+    timestamps.push_back(sampleTimeStamp);
+    offsets.push_back(offset);
+
+    // Pad the frame to the next aligned offset
+    const size_t frameBytes = rowBytes * static_cast<size_t>(frame.rows);
+    const size_t padding = (FRAME_ALIGNMENT - frameBytes % FRAME_ALIGNMENT) % FRAME_ALIGNMENT;
+    offset += frameBytes + padding;
+    return std::fseek(file, static_cast<long>(offset), SEEK_SET) == 0;
+}
+
+bool FrameCacheWriter::finish()
+{
+    if (file == nullptr)
+    {
+        return false;
+    }
+
+    // Index sorted by timestamp for the binary search of the reader
+    std::vector<size_t> order(timestamps.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [this](size_t a, size_t b) {
+        return timestamps[a] < timestamps[b];
+    });
+    bool ok = true;
+    for (size_t i : order)
+    {
+        const uint64_t entry[2] = {static_cast<uint64_t>(timestamps[i]), offsets[i]};
+        ok = ok && std::fwrite(entry, sizeof(uint64_t), 2, file) == 2;
+    }
+
+    uint8_t header[HEADER_SIZE];
+    const uint32_t dimensions[4] = {VERSION, width, height, CHANNELS};
+    const uint64_t values[4] = {size, hash, static_cast<uint64_t>(timestamps.size()), offset};
+    std::memcpy(header, MAGIC, sizeof(MAGIC));
+    std::memcpy(header + 8, dimensions, sizeof(dimensions));
+    std::memcpy(header + 24, values, sizeof(values));
+    ok = ok && std::fseek(file, 0, SEEK_SET) == 0 && std::fwrite(header, 1, sizeof(header), file) == sizeof(header);
+    ok = (std::fclose(file) == 0) && ok;
+    file = nullptr;
+
+    if (!ok || std::rename(temporaryPath.c_str(), finalPath.c_str()) != 0)
+    {
+        ::unlink(temporaryPath.c_str());
+        temporaryPath.clear();
+        return false;
+    }
+    temporaryPath.clear();
+    return true;
+}
+
+void FrameCacheWriter::discard()
+{
+    if (file != nullptr)
+    {
+        std::fclose(file);
+        file = nullptr;
+    }
+    if (!temporaryPath.empty())
+    {
+        ::unlink(temporaryPath.c_str());
+        temporaryPath.clear();
+    }
+}
+
+FrameCacheReader::FrameCacheReader()
+    : data(nullptr), size(0), width(0), height(0), index(nullptr), frameCount(0)
+{
+}
+
+FrameCacheReader::~FrameCacheReader()
+{
+    close();
+}
+
+bool FrameCacheReader::open(const std::string &path, uint64_t recordingSize, uint64_t recordingHash)
+{
+    close();
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        return false;
+    }
+    struct stat status;
+    if (::fstat(fd, &status) != 0 || static_cast<size_t>(status.st_size) < HEADER_SIZE)
+    {
+        ::close(fd);
+        return false;
+    }
+    size = static_cast<size_t>(status.st_size);
+    void *mapping = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED)
+    {
+        size = 0;
+        return false;
+    }
+    data = static_cast<const uint8_t *>(mapping);
+
+    uint32_t dimensions[4];
+    uint64_t values[4];
+    std::memcpy(dimensions, data + 8, sizeof(dimensions));
+    std::memcpy(values, data + 24, sizeof(values));
+    const uint64_t frameBytes = static_cast<uint64_t>(dimensions[1]) * dimensions[2] * CHANNELS;
+    const uint64_t indexOffset = values[3];
+    if (std::memcmp(data, MAGIC, sizeof(MAGIC)) != 0 || dimensions[0] != VERSION || dimensions[3] != CHANNELS ||
+        values[0] != recordingSize || values[1] != recordingHash || values[2] == 0 || indexOffset % 8 != 0 ||
+        indexOffset + values[2] * sizeof(IndexEntry) != size)
+    {
+        close();
+        return false;
+    }
+    index = reinterpret_cast<const IndexEntry *>(data + indexOffset);
+    frameCount = static_cast<size_t>(values[2]);
+    for (size_t i = 0; i < frameCount; i++)
+    {
+        if (index[i].offset < HEADER_SIZE || index[i].offset + frameBytes > indexOffset)
+        {
+            close();
+            return false;
+        }
+    }
+    width = static_cast<int>(dimensions[1]);
+    height = static_cast<int>(dimensions[2]);
+
+    // The frames are read once from the start to the end
+    ::madvise(mapping, size, MADV_SEQUENTIAL);
+    return true;
+}
+
+void FrameCacheReader::close()
+{
+    if (data != nullptr)
+    {
+        ::munmap(const_cast<uint8_t *>(data), size);
+    }
+    data = nullptr;
+    size = 0;
+    index = nullptr;
+    frameCount = 0;
+}
+
+bool FrameCacheReader::find(int64_t sampleTimeStamp, cv::Mat &frame) const
+{
+    const IndexEntry *end = index + frameCount;
+    const IndexEntry *entry = std::lower_bound(index, end, sampleTimeStamp, [](const IndexEntry &e, int64_t timestamp) {
+        return e.sampleTimeStamp < timestamp;
+    });
+    if (entry == end || entry->sampleTimeStamp != sampleTimeStamp)
+    {
+        return false;
+    }
+    frame = cv::Mat(height, width, CV_8UC3, const_cast<uint8_t *>(data + entry->offset));
+    return true;
+}
+
+size_t FrameCacheReader::getFrameCount() const
+{
+    return frameCount;
+}
+
+bool FrameCacheReader::hashFile(const std::string &path, uint64_t &fileSize, uint64_t &fileHash)
+{
+    std::FILE *file = std::fopen(path.c_str(), "rb");
+    if (file == nullptr)
+    {
+        return false;
+    }
+    uint64_t hashValue = 14695981039346656037ULL;
+    uint64_t total = 0;
+    std::vector<uint8_t> buffer(1 << 20);
+    size_t read;
+    while ((read = std::fread(buffer.data(), 1, buffer.size(), file)) > 0)
+    {
+        for (size_t i = 0; i < read; i++)
+        {
+            hashValue = (hashValue ^ buffer[i]) * 1099511628211ULL;
+        }
+        total += read;
+    }
+    const bool ok = std::ferror(file) == 0;
+    std::fclose(file);
+    fileSize = total;
+    fileHash = hashValue;
+    return ok;
+}
@@ -0,0 +1,90 @@
+#ifndef FRAME_CACHE_HPP
+#define FRAME_CACHE_HPP
+
+#include <opencv2/core.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// Decoded frames of a recording in a file that is mapped into memory, so repeated offline runs read the pixels
+// instead of decoding the h264 frames again. All values are little endian:
+//
+//   header  char magic[8] = "CPSFRMC\0", uint32 version = 1, uint32 width, uint32 height, uint32 channels = 3,
+//           uint64 size and uint64 hash of the recording file, uint64 frame count, uint64 offset of the index
+//   frames  width * height * 3 bytes of BGR pixels per frame, every frame starts at a multiple of FRAME_ALIGNMENT
+//   index   {int64 sampleTimeStamp, uint64 offset} of every frame, sorted by the timestamp
+//
+// The file is written under a temporary name and only renamed to its path once it is complete. A cache whose recording
+// size or hash differs from the recording is stale and is rebuilt.
+class FrameCacheWriter {
+    public:
+        FrameCacheWriter();
+        ~FrameCacheWriter();
+
+        FrameCacheWriter(const FrameCacheWriter &) = delete;
+        FrameCacheWriter &operator=(const FrameCacheWriter &) = delete;
+
+        // Writes to a temporary file next to the path, which replaces the path in finish
+        bool create(const std::string &path, uint64_t recordingSize, uint64_t recordingHash);
+
+        // 8 bit BGR frame, all frames have the size of the first one
+        bool append(int64_t sampleTimeStamp, const cv::Mat &frame);
+
+        // Writes the index and the header and moves the file into place
+        bool finish();
+
+        static const size_t FRAME_ALIGNMENT = 4096;
+
+    private:
+        void discard();
+
+        std::FILE *file;
+        std::string finalPath;
+        std::string temporaryPath;
+        uint64_t size;
+        uint64_t hash;
+        uint32_t width;
+        uint32_t height;
+        uint64_t offset;
+        std::vector<int64_t> timestamps;
+        std::vector<uint64_t> offsets;
+};
+
+class FrameCacheReader {
+    public:
+        FrameCacheReader();
+        ~FrameCacheReader();
+
+        FrameCacheReader(const FrameCacheReader &) = delete;
+        FrameCacheReader &operator=(const FrameCacheReader &) = delete;
+
+        // False if the file does not exist, is not complete or belongs to a different recording
+        bool open(const std::string &path, uint64_t recordingSize, uint64_t recordingHash);
+        void close();
+
+        // The frame with the sample timestamp as a BGR image that points into the mapping
+        bool find(int64_t sampleTimeStamp, cv::Mat &frame) const;
+
+        size_t getFrameCount() const;
+
+        // Size and FNV-1a hash of the contents of a file
+        static bool hashFile(const std::string &path, uint64_t &fileSize, uint64_t &fileHash);
+
+    private:
+        struct IndexEntry {
+            int64_t sampleTimeStamp;
+            uint64_t offset;
+        };
+
+        const uint8_t *data;
+        size_t size;
+        int width;
+        int height;
+        const IndexEntry *index;
+        size_t frameCount;
+};
+
+#endif // FRAME_CACHE_HPP
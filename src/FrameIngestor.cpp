@@ -0,0 +1,214 @@
+#include "FrameIngestor.hpp"
+
+#include "cluon-complete.hpp"
+
+#include <algorithm>
+#include <chrono>
+
+FrameIngestor::FrameIngestor(cluon::SharedMemory &memory, uint32_t width, uint32_t height, const cv::Rect &roi, FrameAccess access, size_t slots)
+    : sharedMemory(memory), frameWidth(width), frameHeight(height), regionOfInterest(roi), frameAccess(access),
+      ring(std::max<size_t>(slots, 3)), ringMutex(), frameReady(), nextSequence(0), finished(false), readingSlot(ring.size()),
+      running(false), exited(false), threadExited(), thread(), ingestedFrames(0), droppedFrames(0), lateFrames(0), lockStats("shared memory lock held")
+{
+    // Allocate all buffers up front, the ingestion thread only copies into them
+    for (Slot &slot : ring)
+    {
+        slot.frame.image = cv::Mat::zeros(static_cast<int>(frameHeight), static_cast<int>(frameWidth), CV_8UC4);
+    }
+}
+
+FrameIngestor::~FrameIngestor()
+{
+    stop();
+}
+
+void FrameIngestor::start()
+{
+    running = true;
+    thread = std::thread(&FrameIngestor::run, this);
+}
+
+void FrameIngestor::stop()
+{
+    if (!running.exchange(false))
+    {
+        return;
+    }
+
+    // The ingestion thread sees the flag once its wait returns with the next frame. A notification would wake every
+    // process that waits on the shared memory as if a frame had arrived, so it is only sent when the producer has
+    // not delivered a frame for STOP_TIMEOUT_MS, e.g. because it has ended
+    {
+        std::unique_lock<std::mutex> lck(ringMutex);
+        while (thread.joinable() && !threadExited.wait_for(lck, std::chrono::milliseconds(STOP_TIMEOUT_MS), [this]() {
+            return exited;
+        }))
+        {
+            lck.unlock();
+            sharedMemory.notifyAll();
+            lck.lock();
+        }
+    }
+    if (thread.joinable())
+    {
+        thread.join();
+    }
+
+    std::lock_guard<std::mutex> lck(ringMutex);
+    finished = true;
+    frameReady.notify_all();
+}
+
+IngestedFrame *FrameIngestor::acquire()
+{
+    std::unique_lock<std::mutex> lck(ringMutex);
+
+    // Hand the previous frame back to the ring
+    if (readingSlot < ring.size())
+    {
+        ring[readingSlot].state = SlotState::FREE;
+        readingSlot = ring.size();
+    }
+
+    size_t oldest = ring.size();
+    size_t waiting = 0;
+    frameReady.wait(lck, [&]() {
+        oldest = ring.size();
+        waiting = 0;
+        for (size_t i = 0; i < ring.size(); i++)
+        {
+            if (ring[i].state == SlotState::READY)
+            {
+                waiting++;
+                if (oldest == ring.size() || ring[i].sequence < ring[oldest].sequence)
+                {
+                    oldest = i;
+                }
+            }
+        }
+        return waiting != 0 || finished;
+    });
+
+    if (waiting == 0)
+    {
+        return nullptr;
+    }
+
+    // A newer frame already arrived while this one was waiting to be processed
+    if (waiting > 1)
+    {
+        lateFrames++;
+    }
+
+    ring[oldest].state = SlotState::READING;
+    readingSlot = oldest;
+    return &ring[oldest].frame;
+}
+
+uint64_t FrameIngestor::getIngestedFrames() const
+{
+    return ingestedFrames;
+}
+
+uint64_t FrameIngestor::getDroppedFrames() const
+{
+    return droppedFrames;
+}
+
+uint64_t FrameIngestor::getLateFrames() const
+{
+    return lateFrames;
+}
+
+void FrameIngestor::printStats(std::ostream &out)
+{
+    std::lock_guard<std::mutex> lck(ringMutex);
+    out << "ingested " << ingestedFrames << " frames, dropped " << droppedFrames << ", late " << lateFrames << "; ";
+    lockStats.print(out);
+    lockStats.reset();
+}
+
+size_t FrameIngestor::claimSlotForWriting()
+{
+    std::lock_guard<std::mutex> lck(ringMutex);
+
+    // Prefer a free slot, otherwise overwrite the oldest frame that was not processed in time
+    size_t oldest = ring.size();
+    for (size_t i = 0; i < ring.size(); i++)
+    {
+        if (ring[i].state == SlotState::FREE)
+        {
+            ring[i].state = SlotState::WRITING;
+            return i;
+        }
+        if (ring[i].state == SlotState::READY && (oldest == ring.size() || ring[i].sequence < ring[oldest].sequence))
+        {
+            oldest = i;
+        }
+    }
+
+    // With at least three slots there is always a free or a ready slot, as only one is read and one is written
+    droppedFrames++;
+    ring[oldest].state = SlotState::WRITING;
+    return oldest;
+}
+
+void FrameIngestor::run()
+{
+    int64_t previousTimeStamp = 0;
+
+    while (running)
+    {
+        // Wait for a notification of a new frame.
+        sharedMemory.wait();
+        if (!running)
+        {
+            break;
+        }
+
+        size_t index = claimSlotForWriting();
+        IngestedFrame &frame = ring[index].frame;
+
+        auto lockStart = std::chrono::steady_clock::now();
+        sharedMemory.lock();
+        {
+            cv::Mat wrapped(static_cast<int>(frameHeight), static_cast<int>(frameWidth), CV_8UC4, sharedMemory.data());
+            if (frameAccess == FrameAccess::CLONE)
+            {
+                wrapped.copyTo(frame.image);
+            }
+            else
+            {
+                wrapped(regionOfInterest).copyTo(frame.image(regionOfInterest));
+            }
+
+            std::pair<bool, cluon::data::TimeStamp> timeStamp = sharedMemory.getTimeStamp();
+            frame.hasTimeStamp = timeStamp.first;
+            frame.sampleTimeStamp = cluon::time::toMicroseconds(timeStamp.second);
+        }
+        sharedMemory.unlock();
+        auto lockDuration = std::chrono::steady_clock::now() - lockStart;
+
+        std::lock_guard<std::mutex> lck(ringMutex);
+        lockStats.add(lockDuration);
+
+        // The replay is over once the producer delivers the same frame again
+        if (frame.hasTimeStamp && frame.sampleTimeStamp == previousTimeStamp)
+        {
+            ring[index].state = SlotState::FREE;
+            finished = true;
+            frameReady.notify_all();
+            break;
+        }
+        previousTimeStamp = frame.sampleTimeStamp;
+
+        ring[index].sequence = nextSequence++;
+        ring[index].state = SlotState::READY;
+        ingestedFrames++;
+        frameReady.notify_one();
+    }
+
+    std::lock_guard<std::mutex> lck(ringMutex);
+    exited = true;
+    threadExited.notify_all();
+}
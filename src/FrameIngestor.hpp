@@ -0,0 +1,111 @@
+#ifndef FRAME_INGESTOR_HPP
+#define FRAME_INGESTOR_HPP
+
+#include <opencv2/core.hpp>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <thread>
+#include <vector>
+
+#include "DurationStats.hpp"
+
+namespace cluon {
+class SharedMemory;
+}
+
+// How the frame is taken from the shared memory
+enum class FrameAccess {
+    // Copy the whole frame
+    CLONE,
+    // Copy only the region of interest
+    ROI,
+    // Copy nothing and process the region of interest while the shared memory is locked
+    INPLACE
+};
+
+// A frame copied out of the shared memory into one of the preallocated buffers of the ring
+struct IngestedFrame {
+    cv::Mat image{};
+    bool hasTimeStamp{false};
+    int64_t sampleTimeStamp{0};
+};
+
+// Copies frames from the shared memory on its own thread into a ring of preallocated buffers,
+// so that a slow frame on the processing thread does not make us miss notifications of the producer
+class FrameIngestor {
+    public:
+        FrameIngestor(cluon::SharedMemory &memory, uint32_t width, uint32_t height, const cv::Rect &roi, FrameAccess access, size_t slots = 3);
+        ~FrameIngestor();
+
+        FrameIngestor(const FrameIngestor &) = delete;
+        FrameIngestor &operator=(const FrameIngestor &) = delete;
+
+        void start();
+        void stop();
+
+        // Blocks until the next frame is available and hands the previously acquired frame back to the ring.
+        // Returns nullptr once the producer repeats a frame (end of the replay) or the ingestor was stopped.
+        IngestedFrame *acquire();
+
+        uint64_t getIngestedFrames() const;
+        uint64_t getDroppedFrames() const;
+        uint64_t getLateFrames() const;
+
+        void printStats(std::ostream &out);
+
+        // How long stop waits for the next frame of the producer before it wakes up the ingestion thread itself
+        static const int STOP_TIMEOUT_MS = 500;
+
+    private:
+        enum class SlotState {
+            FREE,
+            WRITING,
+            READY,
+            READING
+        };
+
+        struct Slot {
+            IngestedFrame frame{};
+            SlotState state{SlotState::FREE};
+            uint64_t sequence{0};
+        };
+
+        void run();
+        size_t claimSlotForWriting();
+
+        cluon::SharedMemory &sharedMemory;
+        const uint32_t frameWidth;
+        const uint32_t frameHeight;
+        const cv::Rect regionOfInterest;
+        const FrameAccess frameAccess;
+
+        std::vector<Slot> ring;
+        std::mutex ringMutex;
+        std::condition_variable frameReady;
+        uint64_t nextSequence;
+        bool finished;
+        // Slot that is held by the processing thread, ring.size() if none
+        size_t readingSlot;
+
+        std::atomic<bool> running;
+        // Set under ringMutex when the ingestion thread leaves
+        bool exited;
+        std::condition_variable threadExited;
+        std::thread thread;
+
+        std::atomic<uint64_t> ingestedFrames;
+        // Frames that were overwritten before the processing thread took them
+        std::atomic<uint64_t> droppedFrames;
+        // Frames that were taken while a newer frame was already waiting
+        std::atomic<uint64_t> lateFrames;
+
+        // Only updated by the ingestion thread, printed under ringMutex
+        DurationStats lockStats;
+};
+
+#endif // FRAME_INGESTOR_HPP
@@ -0,0 +1,62 @@
+#include "FrameWorkspace.hpp"
+
+#include <algorithm>
+
+FrameWorkspace::FrameWorkspace(ImageDenoiser::Mode denoiseMode)
+    : frame(), maskBlue(), maskYellow(), processedBlue(), processedYellow(), denoiserBlue(denoiseMode), denoiserYellow(denoiseMode), warmData(), warm(false)
+{
+}
+
+void FrameWorkspace::allocate(uint32_t width, uint32_t height, const cv::Rect &roi, size_t strips)
+{
+    frame = cv::Mat::zeros(static_cast<int>(height), static_cast<int>(width), CV_8UC4);
+
+    maskBlue.create(roi.size(), CV_8U);
+    maskYellow.create(roi.size(), CV_8U);
+    processedBlue.create(roi.size(), CV_8U);
+    processedYellow.create(roi.size(), CV_8U);
+
+    denoiserBlue.configure(roi.size(), CV_8UC4, 5, ImageDenoiser::carRegion(roi.size()), strips);
+    denoiserYellow.configure(roi.size(), CV_8UC4, 5, ImageDenoiser::carRegion(roi.size()), strips);
+
+    warm = false;
+}
+
+void FrameWorkspace::markWarm()
+{
+    std::array<const cv::Mat *, BUFFER_COUNT> current = buffers();
+    for (size_t i = 0; i < BUFFER_COUNT; i++)
+    {
+        warmData[i] = current[i]->data;
+    }
+    warm = true;
+}
+
+size_t FrameWorkspace::countReallocations() const
+{
+    if (!warm)
+    {
+        return 0;
+    }
+
+    std::array<const cv::Mat *, BUFFER_COUNT> current = buffers();
+    size_t reallocations = 0;
+    for (size_t i = 0; i < BUFFER_COUNT; i++)
+    {
+        if (current[i]->data != warmData[i])
+        {
+            reallocations++;
+        }
+    }
+    return reallocations;
+}
+
+std::array<const cv::Mat *, FrameWorkspace::BUFFER_COUNT> FrameWorkspace::buffers() const
+{
+    std::array<const cv::Mat *, BUFFER_COUNT> all{{&frame, &maskBlue, &maskYellow, &processedBlue, &processedYellow}};
+    std::array<const cv::Mat *, 4> blue = denoiserBlue.buffers();
+    std::array<const cv::Mat *, 4> yellow = denoiserYellow.buffers();
+    std::copy(blue.begin(), blue.end(), all.begin() + 5);
+    std::copy(yellow.begin(), yellow.end(), all.begin() + 9);
+    return all;
+}
@@ -0,0 +1,47 @@
+#ifndef FRAME_WORKSPACE_HPP
+#define FRAME_WORKSPACE_HPP
+
+#include <opencv2/core.hpp>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include "ImageDenoiser.hpp"
+
+// Owns every image buffer that is needed to process a frame. The buffers are allocated once from the frame
+// geometry and reused, so that no image memory is allocated per frame in steady state.
+class FrameWorkspace {
+    public:
+        explicit FrameWorkspace(ImageDenoiser::Mode denoiseMode = ImageDenoiser::Mode::FUSED);
+
+        // The denoisers are split into the given number of strips of rows
+        void allocate(uint32_t width, uint32_t height, const cv::Rect &roi, size_t strips = 1);
+
+        // Test hook: remember where every buffer lives after the warm-up frames...
+        void markWarm();
+        // ...and count the buffers that were reallocated since then, which has to stay zero
+        size_t countReallocations() const;
+
+        // Our copy of the frame, which is drawn on and displayed
+        cv::Mat frame;
+
+        cv::Mat maskBlue;
+        cv::Mat maskYellow;
+        cv::Mat processedBlue;
+        cv::Mat processedYellow;
+
+        // One denoiser per color, both configured with the geometry of the region of interest
+        ImageDenoiser denoiserBlue;
+        ImageDenoiser denoiserYellow;
+
+    private:
+        static const size_t BUFFER_COUNT = 13;
+
+        std::array<const cv::Mat *, BUFFER_COUNT> buffers() const;
+
+        std::array<const uint8_t *, BUFFER_COUNT> warmData;
+        bool warm;
+};
+
+#endif // FRAME_WORKSPACE_HPP
@@ -1,33 +1,172 @@
 #include "ImageDenoiser.hpp"
 #include <opencv2/imgproc.hpp>
 
-void ImageDenoiser::denoiseImage(cv::Mat &originalImage, cv::Mat &colorMask, cv::Mat &processedImage, int thresholdValue, int maxValue)
+#include <algorithm>
+
+ImageDenoiser::ImageDenoiser(Mode denoiserMode)
+    : mode(denoiserMode), kernel(5, 5), ignored(), ignoreMask(), element(), colorMaskCopy(), maskedImage(), fusedKernels(1)
+{
+}
+
+void ImageDenoiser::configure(const cv::Size &imageSize, int imageType, int kernelSize, const cv::Rect &ignoreRegion, size_t strips)
+{
+    kernel = cv::Size(kernelSize, kernelSize);
+    ignoreMask.create(imageSize, CV_8U);
+
+    if (mode == Mode::FUSED && !DenoiseKernel::isSupported(imageSize.width, imageSize.height, kernelSize))
+    {
+        mode = Mode::OPENCV;
+    }
+
+    if (mode == Mode::FUSED)
+    {
+        fusedKernels.resize(std::max<size_t>(strips, 1));
+        for (DenoiseKernel &fusedKernel : fusedKernels)
+        {
+            fusedKernel.configure(imageSize.width, imageSize.height, kernelSize);
+        }
+    }
+    else
+    {
+        element = cv::getStructuringElement(cv::MORPH_RECT, kernel);
+        colorMaskCopy.create(imageSize, CV_8U);
+        if (mode == Mode::OPENCV)
+        {
+            maskedImage.create(imageSize, imageType);
+        }
+    }
+
+    setIgnoreRegion(ignoreRegion);
+}
+
+void ImageDenoiser::setIgnoreRegion(const cv::Rect &ignoreRegion)
+{
+    // Create a mask to ignore the region, parts outside of the image are dropped
+    ignored = ignoreRegion & cv::Rect(0, 0, ignoreMask.cols, ignoreMask.rows);
+    ignoreMask.setTo(cv::Scalar::all(1));
+    ignoreMask(ignored).setTo(cv::Scalar::all(0));
+}
+
+ImageDenoiser::Mode ImageDenoiser::getMode() const
+{
+    return mode;
+}
+
+const cv::Rect &ImageDenoiser::getIgnoreRegion() const
+{
+    return ignored;
+}
+
+void ImageDenoiser::denoiseImage(const cv::Mat &originalImage, const cv::Mat &colorMask, cv::Mat &processedImage, int thresholdValue, int maxValue)
 {
+    if (mode == Mode::FUSED)
+    {
+        processedImage.create(colorMask.size(), CV_8U);
+        denoiseRows(originalImage, colorMask, processedImage, thresholdValue, maxValue, fusedKernels.front(), 0, colorMask.rows);
+        return;
+    }
+
     // Create a copy of the colorMask to preserve the original data
-    cv::Mat colorMaskCopy;
     colorMask.copyTo(colorMaskCopy);
 
     // Apply Gaussian Blur to the color mask to reduce noise
-    cv::GaussianBlur(colorMaskCopy, colorMaskCopy, cv::Size(5, 5), 0);
+    cv::GaussianBlur(colorMaskCopy, colorMaskCopy, kernel, 0);
 
     // Apply Closing operation to the color mask to improve quality
-    cv::Mat element = cv::getStructuringElement(cv::MORPH_RECT, cv::Size(5, 5));
     cv::morphologyEx(colorMaskCopy, colorMaskCopy, cv::MORPH_CLOSE, element);
 
-    // Create a mask to ignore the car at the bottom-center of the image
-    cv::Mat mask = cv::Mat::ones(originalImage.size(), CV_8U);
-    cv::Rect ignoreRegion(mask.cols / 4, 3 * mask.rows / 4, mask.cols / 2, mask.rows / 4);
-    mask(ignoreRegion) = 0;
+    if (mode == Mode::MASK)
+    {
+        // Combine the cleaned mask with the ignore mask and the gray value test row by row, without the masked color image
+        processedImage.create(colorMask.size(), CV_8U);
+        const uint8_t maxByte = cv::saturate_cast<uint8_t>(maxValue);
+        for (int y = 0; y < colorMaskCopy.rows; y++)
+        {
+            DenoiseKernel::thresholdRow(colorMaskCopy.ptr<uint8_t>(y), ignoreMask.ptr<uint8_t>(y), originalImage.ptr<uint8_t>(y), originalImage.channels(),
+                                        static_cast<size_t>(colorMaskCopy.cols), thresholdValue, maxByte, DenoiseKernel::MaskTest::NONZERO,
+                                        processedImage.ptr<uint8_t>(y));
+        }
+        return;
+    }
 
     // Apply the mask to the colorMaskCopy
-    colorMaskCopy = colorMaskCopy & mask;
+    cv::bitwise_and(colorMaskCopy, ignoreMask, colorMaskCopy);
 
-    // Perform a Bitwise And operation to extract the color information from the original image
-    cv::bitwise_and(originalImage, originalImage, processedImage, colorMaskCopy);
+    // Perform a Bitwise And operation to extract the color information from the original image,
+    // the reused buffer keeps the pixels outside of the mask from the previous frame, so clear it first
+    maskedImage.setTo(cv::Scalar::all(0));
+    cv::bitwise_and(originalImage, originalImage, maskedImage, colorMaskCopy);
 
     // Convert the processed image to Grayscale
-    cv::cvtColor(processedImage, processedImage, cv::COLOR_BGR2GRAY);
+    cv::cvtColor(maskedImage, processedImage, cv::COLOR_BGR2GRAY);
 
     // Apply a Threshold to the processed image
     cv::threshold(processedImage, processedImage, thresholdValue, maxValue, cv::THRESH_BINARY);
-}
\ No newline at end of file
+}
+
+void ImageDenoiser::denoiseStrip(const cv::Mat &originalImage, const cv::Mat &colorMask, cv::Mat &processedImage, int thresholdValue, int maxValue,
+                                 size_t strip)
+{
+    if (mode != Mode::FUSED)
+    {
+        denoiseImage(originalImage, colorMask, processedImage, thresholdValue, maxValue);
+        return;
+    }
+
+    const size_t strips = fusedKernels.size();
+    const int firstRow = static_cast<int>(static_cast<size_t>(colorMask.rows) * strip / strips);
+    const int lastRow = static_cast<int>(static_cast<size_t>(colorMask.rows) * (strip + 1) / strips);
+    denoiseRows(originalImage, colorMask, processedImage, thresholdValue, maxValue, fusedKernels[strip], firstRow, lastRow);
+}
+
+size_t ImageDenoiser::getStripCount() const
+{
+    return (mode == Mode::FUSED) ? fusedKernels.size() : 1;
+}
+
+void ImageDenoiser::denoiseRows(const cv::Mat &originalImage, const cv::Mat &colorMask, cv::Mat &processedImage, int thresholdValue, int maxValue,
+                                DenoiseKernel &fusedKernel, int firstRow, int lastRow) const
+{
+    DenoiseImages images;
+    images.mask = colorMask.ptr<uint8_t>();
+    images.maskStep = colorMask.step;
+    images.pixels = originalImage.ptr<uint8_t>();
+    images.pixelStep = originalImage.step;
+    images.channels = originalImage.channels();
+    images.ignoreMask = ignoreMask.ptr<uint8_t>();
+    images.ignoreStep = ignoreMask.step;
+    images.output = processedImage.ptr<uint8_t>();
+    images.outputStep = processedImage.step;
+    fusedKernel.run(images, thresholdValue, maxValue, firstRow, lastRow);
+}
+
+std::array<const cv::Mat *, 4> ImageDenoiser::buffers() const
+{
+    return {{&ignoreMask, &element, &colorMaskCopy, &maskedImage}};
+}
+
+cv::Rect ImageDenoiser::carRegion(const cv::Size &imageSize)
+{
+    return cv::Rect(imageSize.width / 4, 3 * imageSize.height / 4, imageSize.width / 2, imageSize.height / 4);
+}
+
+bool ImageDenoiser::parseMode(const std::string &name, Mode &denoiserMode)
+{
+    if (name == "opencv")
+    {
+        denoiserMode = Mode::OPENCV;
+    }
+    else if (name == "fused")
+    {
+        denoiserMode = Mode::FUSED;
+    }
+    else if (name == "mask")
+    {
+        denoiserMode = Mode::MASK;
+    }
+    else
+    {
+        return false;
+    }
+    return true;
+}
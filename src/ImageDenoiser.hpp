@@ -3,9 +3,76 @@
 
 #include <opencv2/core.hpp>
 
+#include <array>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "DenoiseKernel.hpp"
+
+// Denoises a color mask and extracts the matching pixels of the original image. The ignore mask, the
+// structuring element and the scratch buffers only depend on the frame geometry, so they are built once
+// in configure() and reused for every frame.
 class ImageDenoiser {
     public:
-        static void denoiseImage(cv::Mat &originalImage, cv::Mat &colorMask, cv::Mat &processedImage, int thresholdValue, int maxValue);
+        enum class Mode {
+            // One OpenCV function per step, every step passes over the whole image
+            OPENCV,
+            // DenoiseKernel runs all steps in one pass over cache sized strips of rows, with a bit-exact result
+            FUSED,
+            // OpenCV blurs and closes the mask, then every pixel whose cleaned mask is not 0 passes if its gray value is
+            // above the threshold. The masked color image is never stored. Unlike the other modes, even mask values pass
+            // too, so the masks are more solid and the results differ.
+            MASK
+        };
+
+        explicit ImageDenoiser(Mode denoiserMode = Mode::FUSED);
+
+        // With Mode::FUSED the image can be split into several strips of rows, see denoiseStrip
+        void configure(const cv::Size &imageSize, int imageType, int kernelSize, const cv::Rect &ignoreRegion, size_t strips = 1);
+
+        // Kernel sizes that DenoiseKernel does not support are run with Mode::OPENCV
+        Mode getMode() const;
+
+        // Move the ignored region, the cached mask is rewritten in place and not reallocated
+        void setIgnoreRegion(const cv::Rect &ignoreRegion);
+        const cv::Rect &getIgnoreRegion() const;
+
+        void denoiseImage(const cv::Mat &originalImage, const cv::Mat &colorMask, cv::Mat &processedImage, int thresholdValue, int maxValue);
+
+        // Denoises one of getStripCount() horizontal strips, the strips may run on different threads at the same time.
+        // Every strip has its own DenoiseKernel, which recomputes the blurred and closed rows around the strip, so the
+        // result is the same as with denoiseImage. processedImage has to be allocated with the size of the mask.
+        void denoiseStrip(const cv::Mat &originalImage, const cv::Mat &colorMask, cv::Mat &processedImage, int thresholdValue, int maxValue,
+                          size_t strip);
+        // The OpenCV modes always have one strip
+        size_t getStripCount() const;
+
+        // The buffers owned by the denoiser, to check that they are not reallocated
+        std::array<const cv::Mat *, 4> buffers() const;
+
+        // Region of the car at the bottom-center of the image
+        static cv::Rect carRegion(const cv::Size &imageSize);
+
+        static bool parseMode(const std::string &name, Mode &denoiserMode);
+
+    private:
+        void denoiseRows(const cv::Mat &originalImage, const cv::Mat &colorMask, cv::Mat &processedImage, int thresholdValue, int maxValue,
+                         DenoiseKernel &fusedKernel, int firstRow, int lastRow) const;
+
+        Mode mode;
+        cv::Size kernel;
+        cv::Rect ignored;
+
+        // Ones everywhere except for the ignored region
+        cv::Mat ignoreMask;
+        cv::Mat element;
+
+        cv::Mat colorMaskCopy;
+        cv::Mat maskedImage;
+
+        // One kernel per strip
+        std::vector<DenoiseKernel> fusedKernels;
 };
 
 #endif // IMAGE_DENOISER_HPP
@@ -0,0 +1,71 @@
+#ifndef LATEST_VALUE_HPP
+#define LATEST_VALUE_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+// Latest value of a message for exactly one writer thread and one reader thread, as a triple buffer. The writer fills
+// its own buffer and swaps it with the shared middle buffer, the reader swaps its buffer with the middle buffer when
+// the middle one is newer. Both sides only exchange one atomic index, so the receiver thread of the OD4 session never
+// waits for the vision thread or the other way round, and the reader never sees a half written value.
+template <typename T>
+class LatestValue {
+    public:
+        LatestValue()
+            : buffers(), writeIndex(0), middle(1), readIndex(2)
+        {
+        }
+
+        LatestValue(const LatestValue &) = delete;
+        LatestValue &operator=(const LatestValue &) = delete;
+
+        // Writer side
+        void store(const T &value)
+        {
+            buffers[writeIndex].value = value;
+            publish();
+        }
+
+        void store(T &&value)
+        {
+            buffers[writeIndex].value = std::move(value);
+            publish();
+        }
+
+        // Reader side, a default constructed value until the first store
+        const T &load()
+        {
+            if ((middle.load(std::memory_order_relaxed) & FRESH) != 0)
+            {
+                readIndex = middle.exchange(readIndex, std::memory_order_acq_rel) & INDEX;
+            }
+            return buffers[readIndex].value;
+        }
+
+    private:
+        void publish()
+        {
+            writeIndex = middle.exchange(static_cast<uint8_t>(writeIndex | FRESH), std::memory_order_acq_rel) & INDEX;
+        }
+
+        // The middle index carries a flag that is set when the writer has put a value there that was not read yet
+        static const uint8_t INDEX = 0x03;
+        static const uint8_t FRESH = 0x04;
+        static const size_t CACHE_LINE = 64;
+
+        // Every buffer on its own cache line, the writer and the reader use different ones at any time
+        struct alignas(CACHE_LINE) Buffer {
+            T value{};
+        };
+        Buffer buffers[3];
+
+        // Only used by the writer
+        alignas(CACHE_LINE) uint8_t writeIndex;
+        alignas(CACHE_LINE) std::atomic<uint8_t> middle;
+        // Only used by the reader
+        alignas(CACHE_LINE) uint8_t readIndex;
+};
+
+#endif // LATEST_VALUE_HPP
@@ -0,0 +1,91 @@
+#include "RecordingEvaluator.hpp"
+
+#include "cluon-complete.hpp"
+#include "opendlv-standard-message-set.hpp"
+
+#include <chrono>
+#include <vector>
+
+#include "RecordingReader.hpp"
+#include "WorkerPool.hpp"
+
+RecordingEvaluator::RecordingEvaluator(const EvaluationSettings &evaluationSettings)
+    : settings(evaluationSettings)
+{
+}
+
+EvaluationResult RecordingEvaluator::evaluate(const std::string &recording)
+{
+    EvaluationResult result;
+    result.recording = recording;
+    const auto start = std::chrono::steady_clock::now();
+
+    RecordingReader reader{recording, settings.frameCache};
+    if (!reader.open())
+    {
+        result.error = "cannot decode the h264 frames";
+        return result;
+    }
+
+    // The recordings run in parallel, so every frame is processed on this thread alone
+    WorkerPool pool{0};
+    ConeDetector detector{settings.colorMode, settings.denoiseMode, settings.blobMode};
+    detector.allocate(settings.width, settings.height, 1);
+    detector.setColorRanges(settings.colors);
+    detector.setThresholds(settings.colors);
+    FrameWorkspace &workspace = detector.getWorkspace();
+
+    SteeringEstimator estimator{settings.steering.delayFrames, settings.steering.interpolateSensors};
+    estimator.setAngularDivisor(settings.steering.angularDivisor);
+
+    std::vector<cv::Rect> boxesBlue;
+    std::vector<cv::Rect> boxesYellow;
+    cluon::data::Envelope envelope;
+    bool frameDecoded = false;
+    while (reader.next(envelope, workspace.frame, frameDecoded))
+    {
+        // Pass the sensor values in their order between the frames
+        if (envelope.dataType() == opendlv::proxy::GroundSteeringRequest::ID())
+        {
+            opendlv::proxy::GroundSteeringRequest request = cluon::extractMessage<opendlv::proxy::GroundSteeringRequest>(std::move(envelope));
+            estimator.addGroundSteering(request.groundSteering());
+            continue;
+        }
+        if (envelope.dataType() == opendlv::proxy::AngularVelocityReading::ID())
+        {
+            const int64_t sampleTimeStamp = cluon::time::toMicroseconds(envelope.sampleTimeStamp());
+            opendlv::proxy::AngularVelocityReading reading = cluon::extractMessage<opendlv::proxy::AngularVelocityReading>(std::move(envelope));
+            estimator.addAngularVelocity(sampleTimeStamp, reading.angularVelocityZ());
+            continue;
+        }
+        if (!frameDecoded)
+        {
+            continue;
+        }
+        if (workspace.frame.cols != static_cast<int>(settings.width) || workspace.frame.rows != static_cast<int>(settings.height))
+        {
+            result.error = "the frames are " + std::to_string(workspace.frame.cols) + "x" + std::to_string(workspace.frame.rows) + " pixels";
+            return result;
+        }
+
+        const cv::Mat imageROI = workspace.frame(detector.getRoi());
+        detector.classifyAndDenoise(imageROI, workspace.maskBlue, workspace.maskYellow, workspace.processedBlue, workspace.processedYellow, pool);
+        detector.findCones(workspace.processedBlue, workspace.processedYellow, pool, boxesBlue, boxesYellow);
+
+        const SteeringResult steering = estimator.estimate(true, cluon::time::toMicroseconds(envelope.sampleTimeStamp()));
+        if (steering.hasLine)
+        {
+            result.score.add(SteeringScore::toCsvPrecision(steering.lineGround), SteeringScore::toCsvPrecision(steering.output));
+        }
+        result.frames++;
+    }
+    if (reader.hasFailed())
+    {
+        result.error = "the decoder does not return one image per h264 frame";
+        return result;
+    }
+
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    result.ok = true;
+    return result;
+}
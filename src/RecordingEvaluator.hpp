@@ -0,0 +1,53 @@
+#ifndef RECORDING_EVALUATOR_HPP
+#define RECORDING_EVALUATOR_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "BlobDetector.hpp"
+#include "ConeColorStage.hpp"
+#include "ConeDetector.hpp"
+#include "ImageDenoiser.hpp"
+#include "SteeringEstimator.hpp"
+#include "SteeringScore.hpp"
+
+// Everything that decides the output lines of a recording
+struct EvaluationSettings {
+    uint32_t width{640};
+    uint32_t height{480};
+    ConeColorStage::Mode colorMode{ConeColorStage::Mode::FUSED};
+    ImageDenoiser::Mode denoiseMode{ImageDenoiser::Mode::FUSED};
+    BlobDetector::Mode blobMode{BlobDetector::Mode::RUNS};
+    SteeringSettings steering{};
+    ConeColorSettings colors{};
+    // Directory of the frame caches, empty to decode the frames every time
+    std::string frameCache{};
+};
+
+struct EvaluationResult {
+    std::string recording{};
+    bool ok{false};
+    std::string error{};
+    size_t frames{0};
+    SteeringScore score{};
+    double seconds{0};
+};
+
+// Replays a recording through the whole frame processing on the calling thread and scores the output lines like
+// compare_data.py scores the CSV file, without writing the file. Every evaluator has its own stages, so one evaluator
+// per thread can evaluate different recordings at the same time.
+class RecordingEvaluator {
+    public:
+        explicit RecordingEvaluator(const EvaluationSettings &evaluationSettings);
+
+        RecordingEvaluator(const RecordingEvaluator &) = delete;
+        RecordingEvaluator &operator=(const RecordingEvaluator &) = delete;
+
+        EvaluationResult evaluate(const std::string &recording);
+
+    private:
+        EvaluationSettings settings;
+};
+
+#endif // RECORDING_EVALUATOR_HPP
@@ -0,0 +1,263 @@
+#include "RecordingReader.hpp"
+
+#include "opendlv-standard-message-set.hpp"
+
+#include <opencv2/imgproc.hpp>
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+
+#include <unistd.h>
+
+RecordingReader::RecordingReader(const std::string &recordingPath, const std::string &frameCacheDirectory)
+    : recording(recordingPath), streamDirectory(), streamPath(), player(), capture(), decoded(), cacheDirectory(frameCacheDirectory),
+      cachePath(), recordingSize(0), recordingHash(0), cache(), cached(false), imageReadings(0), firstDecodable(0), frameCount(0),
+      decodeFailed(false)
+{
+}
+
+RecordingReader::~RecordingReader()
+{
+    capture.release();
+    removeStream();
+}
+
+bool RecordingReader::open()
+{
+    std::ifstream file(recording, std::ios::binary);
+    if (!file.good())
+    {
+        return false;
+    }
+    file.close();
+
+    // Nothing has to be decoded when the cache holds the frames of the recording as it is now
+    if (!cacheDirectory.empty())
+    {
+        const size_t slash = recording.find_last_of('/');
+        cachePath = cacheDirectory + "/" + ((slash == std::string::npos) ? recording : recording.substr(slash + 1)) + ".frames";
+        if (!FrameCacheReader::hashFile(recording, recordingSize, recordingHash))
+        {
+            return false;
+        }
+        if (openCache())
+        {
+            player.reset(new cluon::Player(recording, false, false));
+            return true;
+        }
+    }
+
+    // The decoder takes a file, so the frames go into a private temporary directory
+    char directory[] = "/tmp/recording-XXXXXX";
+    if (::mkdtemp(directory) == nullptr)
+    {
+        return false;
+    }
+    streamDirectory = directory;
+    streamPath = streamDirectory + "/stream.h264";
+
+    // First pass: extract the h264 frames from the first one with a sequence parameter set on, the frames before
+    // refer to parameters that are not in the recording
+    std::vector<int64_t> frameTimeStamps;
+    {
+        std::ofstream stream(streamPath, std::ios::binary);
+        cluon::Player extractor(recording, false, false);
+        size_t index = 0;
+        bool decodable = false;
+        while (extractor.hasMoreData())
+        {
+            std::pair<bool, cluon::data::Envelope> next = extractor.getNextEnvelopeToBeReplayed();
+            if (!next.first)
+            {
+                break;
+            }
+            if (next.second.dataType() != opendlv::proxy::ImageReading::ID())
+            {
+                continue;
+            }
+            const int64_t sampleTimeStamp = cluon::time::toMicroseconds(next.second.sampleTimeStamp());
+            opendlv::proxy::ImageReading image = cluon::extractMessage<opendlv::proxy::ImageReading>(std::move(next.second));
+            if (image.fourcc() != "h264")
+            {
+                continue;
+            }
+            const std::string data = image.data();
+            if (!decodable && hasSequenceParameterSet(data))
+            {
+                decodable = true;
+                firstDecodable = index;
+            }
+            if (decodable)
+            {
+                stream.write(data.data(), static_cast<std::streamsize>(data.size()));
+                frameTimeStamps.push_back(sampleTimeStamp);
+                frameCount++;
+            }
+            index++;
+        }
+        if (!decodable)
+        {
+            return false;
+        }
+    }
+
+    // Decode every frame into the cache now and read them from there, without a usable cache directory the frames
+    // are decoded as they are replayed
+    if (!cacheDirectory.empty() && writeCache(frameTimeStamps) && openCache())
+    {
+        removeStream();
+        player.reset(new cluon::Player(recording, false, false));
+        return true;
+    }
+    if (decodeFailed)
+    {
+        return false;
+    }
+
+    if (!capture.open(streamPath, cv::CAP_FFMPEG))
+    {
+        return false;
+    }
+
+    // Second pass: the envelopes in their order, the frames are decoded as they come
+    player.reset(new cluon::Player(recording, false, false));
+    imageReadings = 0;
+    return true;
+}
+
+bool RecordingReader::next(cluon::data::Envelope &envelope, cv::Mat &frame, bool &frameDecoded)
+{
+    frameDecoded = false;
+    if (!player || decodeFailed)
+    {
+        return false;
+    }
+    std::pair<bool, cluon::data::Envelope> next{false, cluon::data::Envelope{}};
+    if (player->hasMoreData())
+    {
+        next = player->getNextEnvelopeToBeReplayed();
+    }
+    if (!next.first)
+    {
+        // An image that is left over belongs to no frame, the images before it were shown with the wrong envelopes
+        if (!cached && capture.isOpened() && capture.read(decoded))
+        {
+            decodeFailed = true;
+        }
+        capture.release();
+        return false;
+    }
+    envelope = next.second;
+
+    if (envelope.dataType() != opendlv::proxy::ImageReading::ID())
+    {
+        return true;
+    }
+    opendlv::proxy::ImageReading image = cluon::extractMessage<opendlv::proxy::ImageReading>(cluon::data::Envelope{envelope});
+    if (image.fourcc() != "h264")
+    {
+        return true;
+    }
+
+    // The cache holds the frames that were decoded, by their sample timestamps
+    if (cached)
+    {
+        if (cache.find(cluon::time::toMicroseconds(envelope.sampleTimeStamp()), decoded))
+        {
+            cv::cvtColor(decoded, frame, cv::COLOR_BGR2BGRA);
+            frameDecoded = true;
+        }
+        return true;
+    }
+
+    // Every frame from the first decodable one on is decoded to exactly one image, the replay fails when the decoder
+    // runs out of images before the frames
+    if (imageReadings++ >= firstDecodable)
+    {
+        if (!capture.read(decoded))
+        {
+            decodeFailed = true;
+            return false;
+        }
+        cv::cvtColor(decoded, frame, cv::COLOR_BGR2BGRA);
+        frameDecoded = true;
+    }
+    return true;
+}
+
+size_t RecordingReader::getFrameCount() const
+{
+    return frameCount;
+}
+
+bool RecordingReader::hasFailed() const
+{
+    return decodeFailed;
+}
+
+bool RecordingReader::hasSequenceParameterSet(const std::string &frame)
+{
+    // NAL units start after 00 00 01, the type is in the low 5 bits of the first byte
+    for (size_t i = 0; i + 3 < frame.size(); i++)
+    {
+        if (frame[i] == 0 && frame[i + 1] == 0 && frame[i + 2] == 1 && (frame[i + 3] & 0x1f) == 7)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+void RecordingReader::removeStream()
+{
+    if (!streamPath.empty())
+    {
+        std::remove(streamPath.c_str());
+        streamPath.clear();
+    }
+    if (!streamDirectory.empty())
+    {
+        ::rmdir(streamDirectory.c_str());
+        streamDirectory.clear();
+    }
+}
+
+bool RecordingReader::openCache()
+{
+    if (!cache.open(cachePath, recordingSize, recordingHash))
+    {
+        return false;
+    }
+    frameCount = cache.getFrameCount();
+    cached = true;
+    return true;
+}
+
+bool RecordingReader::writeCache(const std::vector<int64_t> &frameTimeStamps)
+{
+    FrameCacheWriter writer;
+    cv::VideoCapture decoder;
+    if (!writer.create(cachePath, recordingSize, recordingHash) || !decoder.open(streamPath, cv::CAP_FFMPEG))
+    {
+        return false;
+    }
+
+    // The decoder returns one image per extracted frame in their order. The images are stored by the timestamps of the
+    // frames at the same position, so a decoder that drops or adds an image would store every later one under the
+    // wrong timestamp; no cache is written then.
+    size_t images = 0;
+    for (; images < frameTimeStamps.size() && decoder.read(decoded); images++)
+    {
+        if (!writer.append(frameTimeStamps[images], decoded))
+        {
+            return false;
+        }
+    }
+    if (images != frameTimeStamps.size() || decoder.read(decoded))
+    {
+        decodeFailed = true;
+        return false;
+    }
+    return writer.finish();
+}
@@ -0,0 +1,76 @@
+#ifndef RECORDING_READER_HPP
+#define RECORDING_READER_HPP
+
+#include "cluon-complete.hpp"
+
+#include <opencv2/core.hpp>
+#include <opencv2/videoio.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "FrameCache.hpp"
+
+// Replays the envelopes of a .rec file as fast as they are read, without the h264 microservice and the shared memory.
+// The h264 frames of the ImageReading envelopes are first extracted into a temporary elementary stream, which is then
+// decoded with the FFmpeg backend of OpenCV while the envelopes are replayed in their order. With a cache directory the
+// decoded frames are written to a frame cache once, and read from it by every later reader of the same recording.
+class RecordingReader {
+    public:
+        explicit RecordingReader(const std::string &recordingPath, const std::string &frameCacheDirectory = "");
+        ~RecordingReader();
+
+        RecordingReader(const RecordingReader &) = delete;
+        RecordingReader &operator=(const RecordingReader &) = delete;
+
+        // False if the recording cannot be read, has no decodable h264 frame, or the decoder does not return one image
+        // per frame when the frame cache is built
+        bool open();
+
+        // Next envelope of the recording, false at the end. For an ImageReading the decoded frame is written to frame
+        // as BGRA like the frames in the shared memory, except for the frames before the first key frame, which the
+        // decoder cannot decode either; frameDecoded tells whether frame was written.
+        bool next(cluon::data::Envelope &envelope, cv::Mat &frame, bool &frameDecoded);
+
+        size_t getFrameCount() const;
+        // Whether the replay ended because the decoder returned fewer or more images than the recording has frames,
+        // which would pair the images with the wrong envelopes
+        bool hasFailed() const;
+
+    private:
+        // Whether the frame carries a sequence parameter set, the decoder can only start at such a frame
+        static bool hasSequenceParameterSet(const std::string &frame);
+
+        void removeStream();
+
+        // Maps the cache of the recording, false if there is none for the current contents of the recording
+        bool openCache();
+        // Decodes the extracted stream into the cache
+        bool writeCache(const std::vector<int64_t> &frameTimeStamps);
+
+        const std::string recording;
+        std::string streamDirectory;
+        std::string streamPath;
+        std::unique_ptr<cluon::Player> player;
+        cv::VideoCapture capture;
+        cv::Mat decoded;
+
+        const std::string cacheDirectory;
+        std::string cachePath;
+        // Size and hash of the recording, which the cache has to match
+        uint64_t recordingSize;
+        uint64_t recordingHash;
+        FrameCacheReader cache;
+        bool cached;
+
+        // ImageReading envelopes that were replayed, and the first one that can be decoded
+        size_t imageReadings;
+        size_t firstDecodable;
+        size_t frameCount;
+        bool decodeFailed;
+};
+
+#endif // RECORDING_READER_HPP
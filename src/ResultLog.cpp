@@ -0,0 +1,248 @@
+#include "ResultLog.hpp"
+
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// The values are written and read in the byte order of the machine, which is little endian on every target of the
+// microservice
+static const char MAGIC[8] = {'C', 'P', 'S', 'R', 'L', 'O', 'G', '\0'};
+static const uint32_t VERSION = 2;
+static const uint32_t COLUMNS = 3;
+static const size_t HEADER_SIZE = 16;
+static const size_t TRAILER_SIZE = 24;
+static const size_t BLOCK_HEADER_SIZE = 8;
+static const size_t ROW_SIZE = sizeof(int64_t) + 2 * sizeof(float);
+
+// Size of a block including its row count, a multiple of 8 bytes as a row takes 16 bytes
+static uint64_t blockSize(uint64_t rows)
+{
+    return BLOCK_HEADER_SIZE + rows * ROW_SIZE;
+}
+
+ResultLogWriter::ResultLogWriter()
+    : file(nullptr), offset(0), timestamps(), ground(), output(), index()
+{
+}
+
+ResultLogWriter::~ResultLogWriter()
+{
+    close();
+}
+
+bool ResultLogWriter::create(const std::string &path)
+{
+    close();
+    file = std::fopen(path.c_str(), "wb");
+    if (file == nullptr)
+    {
+        return false;
+    }
+
+    uint8_t header[HEADER_SIZE];
+    std::memcpy(header, MAGIC, sizeof(MAGIC));
+    std::memcpy(header + 8, &VERSION, sizeof(VERSION));
+    std::memcpy(header + 12, &COLUMNS, sizeof(COLUMNS));
+    std::fwrite(header, 1, sizeof(header), file);
+    offset = HEADER_SIZE;
+    index.clear();
+    return true;
+}
+
+bool ResultLogWriter::isOpen() const
+{
+    return file != nullptr;
+}
+
+void ResultLogWriter::append(int64_t timestamp, double groundSteering, double steeringOutput)
+{
+    timestamps.push_back(timestamp);
+    ground.push_back(static_cast<float>(groundSteering));
+    output.push_back(static_cast<float>(steeringOutput));
+}
+
+void ResultLogWriter::writeBlock()
+{
+    if (file == nullptr || timestamps.empty())
+    {
+        return;
+    }
+
+    // The row count comes first, so a log can be read without its index
+    const uint64_t rows = timestamps.size();
+    std::fwrite(&rows, sizeof(rows), 1, file);
+    std::fwrite(timestamps.data(), sizeof(int64_t), rows, file);
+    std::fwrite(ground.data(), sizeof(float), rows, file);
+    std::fwrite(output.data(), sizeof(float), rows, file);
+    std::fflush(file);
+
+    index.push_back(offset);
+    index.push_back(rows);
+    offset += blockSize(rows);
+    timestamps.clear();
+    ground.clear();
+    output.clear();
+}
+
+void ResultLogWriter::close()
+{
+    if (file == nullptr)
+    {
+        return;
+    }
+    writeBlock();
+
+    std::fwrite(index.data(), sizeof(uint64_t), index.size(), file);
+    const uint64_t trailer[2] = {index.size() / 2, offset};
+    std::fwrite(trailer, sizeof(uint64_t), 2, file);
+    std::fwrite(MAGIC, 1, sizeof(MAGIC), file);
+    std::fclose(file);
+    file = nullptr;
+}
+
+ResultLogReader::ResultLogReader()
+    : data(nullptr), size(0), blocks(), rowCount(0)
+{
+}
+
+ResultLogReader::~ResultLogReader()
+{
+    close();
+}
+
+bool ResultLogReader::open(const std::string &path)
+{
+    close();
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        return false;
+    }
+    struct stat status;
+    if (::fstat(fd, &status) != 0 || static_cast<size_t>(status.st_size) < HEADER_SIZE)
+    {
+        ::close(fd);
+        return false;
+    }
+    size = static_cast<size_t>(status.st_size);
+    void *mapping = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED)
+    {
+        size = 0;
+        return false;
+    }
+    data = static_cast<const uint8_t *>(mapping);
+
+    uint32_t version;
+    std::memcpy(&version, data + 8, sizeof(version));
+    if (std::memcmp(data, MAGIC, sizeof(MAGIC)) != 0 || version != VERSION)
+    {
+        close();
+        return false;
+    }
+
+    // Both ends carry the magic, a log whose writer did not close it has no trailer and is read block by block
+    const bool complete = size >= HEADER_SIZE + TRAILER_SIZE && std::memcmp(data + size - sizeof(MAGIC), MAGIC, sizeof(MAGIC)) == 0;
+    if (complete ? !readIndex() : !readBlocks())
+    {
+        close();
+        return false;
+    }
+    return true;
+}
+
+bool ResultLogReader::readIndex()
+{
+    const uint8_t *trailer = data + size - TRAILER_SIZE;
+    uint64_t blockCount;
+    uint64_t indexOffset;
+    std::memcpy(&blockCount, trailer, sizeof(blockCount));
+    std::memcpy(&indexOffset, trailer + 8, sizeof(indexOffset));
+    if (indexOffset < HEADER_SIZE || indexOffset > size - TRAILER_SIZE || blockCount > size / (2 * sizeof(uint64_t)) ||
+        indexOffset + blockCount * 2 * sizeof(uint64_t) != size - TRAILER_SIZE)
+    {
+        return false;
+    }
+
+    for (uint64_t i = 0; i < blockCount; i++)
+    {
+        uint64_t entry[2];
+        std::memcpy(entry, data + indexOffset + i * sizeof(entry), sizeof(entry));
+        const uint64_t blockOffset = entry[0];
+        const uint64_t rows = entry[1];
+        uint64_t blockRows;
+        if (blockOffset % 8 != 0 || blockOffset < HEADER_SIZE || blockOffset > indexOffset || rows > indexOffset / ROW_SIZE ||
+            blockOffset + blockSize(rows) > indexOffset)
+        {
+            return false;
+        }
+        std::memcpy(&blockRows, data + blockOffset, sizeof(blockRows));
+        if (blockRows != rows)
+        {
+            return false;
+        }
+        addBlock(blockOffset, rows);
+    }
+    return true;
+}
+
+bool ResultLogReader::readBlocks()
+{
+    // The last block may have been cut off by the end of the run, it is left out
+    uint64_t blockOffset = HEADER_SIZE;
+    while (blockOffset + BLOCK_HEADER_SIZE <= size)
+    {
+        uint64_t rows;
+        std::memcpy(&rows, data + blockOffset, sizeof(rows));
+        if (rows == 0 || rows > (size - blockOffset) / ROW_SIZE || blockOffset + blockSize(rows) > size)
+        {
+            break;
+        }
+        addBlock(blockOffset, rows);
+        blockOffset += blockSize(rows);
+    }
+    return true;
+}
+
+void ResultLogReader::addBlock(uint64_t blockOffset, uint64_t rows)
+{
+    const uint8_t *columns = data + blockOffset + BLOCK_HEADER_SIZE;
+    ResultLogBlock block;
+    block.timestamps = reinterpret_cast<const int64_t *>(columns);
+    block.ground = reinterpret_cast<const float *>(columns + rows * sizeof(int64_t));
+    block.output = block.ground + rows;
+    block.rows = static_cast<size_t>(rows);
+    blocks.push_back(block);
+    rowCount += block.rows;
+}
+
+void ResultLogReader::close()
+{
+    if (data != nullptr)
+    {
+        ::munmap(const_cast<uint8_t *>(data), size);
+    }
+    data = nullptr;
+    size = 0;
+    blocks.clear();
+    rowCount = 0;
+}
+
+size_t ResultLogReader::getBlockCount() const
+{
+    return blocks.size();
+}
+
+size_t ResultLogReader::getRowCount() const
+{
+    return rowCount;
+}
+
+ResultLogBlock ResultLogReader::getBlock(size_t block) const
+{
+    return blocks[block];
+}
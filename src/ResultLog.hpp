@@ -0,0 +1,86 @@
+#ifndef RESULT_LOG_HPP
+#define RESULT_LOG_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// Binary columnar version of the output CSV, which can be mapped into memory instead of being parsed. All values are
+// little endian:
+//
+//   header   char magic[8] = "CPSRLOG\0", uint32 version = 2, uint32 column count = 3
+//   block    uint64 rows, int64 sampleTimeStamp[rows], float32 groundSteering[rows], float32 output[rows]
+//   ...
+//   index    {uint64 offset, uint64 rows} of every block
+//   trailer  uint64 block count, uint64 offset of the index, char magic[8]
+//
+// Every block holds the lines of one write of the ResultWriter, so the file is written as the frames come in; the
+// index and the trailer are only written when the log is closed. A log without them, e.g. of a killed run, is read by
+// walking the row counts of the blocks. Every block and its timestamps start at a multiple of 8 bytes, the ground
+// steering at a multiple of 8 and the output only at a multiple of 4 bytes when the block has an odd number of rows.
+struct ResultLogBlock {
+    const int64_t *timestamps{nullptr};
+    const float *ground{nullptr};
+    const float *output{nullptr};
+    size_t rows{0};
+};
+
+class ResultLogWriter {
+    public:
+        ResultLogWriter();
+        ~ResultLogWriter();
+
+        ResultLogWriter(const ResultLogWriter &) = delete;
+        ResultLogWriter &operator=(const ResultLogWriter &) = delete;
+
+        bool create(const std::string &path);
+        bool isOpen() const;
+
+        // The row is kept until the next writeBlock
+        void append(int64_t timestamp, double groundSteering, double steeringOutput);
+        void writeBlock();
+        // Writes the pending rows, the index and the trailer
+        void close();
+
+    private:
+        std::FILE *file;
+        uint64_t offset;
+        std::vector<int64_t> timestamps;
+        std::vector<float> ground;
+        std::vector<float> output;
+        // Offset and rows of every block that was written
+        std::vector<uint64_t> index;
+};
+
+// Maps a result log into memory, the blocks point into the mapping
+class ResultLogReader {
+    public:
+        ResultLogReader();
+        ~ResultLogReader();
+
+        ResultLogReader(const ResultLogReader &) = delete;
+        ResultLogReader &operator=(const ResultLogReader &) = delete;
+
+        // False if the file cannot be mapped or is not a result log. Without the trailer the blocks that were
+        // written completely are read.
+        bool open(const std::string &path);
+        void close();
+
+        size_t getBlockCount() const;
+        size_t getRowCount() const;
+        ResultLogBlock getBlock(size_t block) const;
+
+    private:
+        bool readIndex();
+        bool readBlocks();
+        void addBlock(uint64_t blockOffset, uint64_t rows);
+
+        const uint8_t *data;
+        size_t size;
+        std::vector<ResultLogBlock> blocks;
+        size_t rowCount;
+};
+
+#endif // RESULT_LOG_HPP
@@ -0,0 +1,214 @@
+#include "ResultTable.hpp"
+
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "ResultLog.hpp"
+
+// Longest field that is parsed, the fields are copied to be terminated for strtod
+static const size_t FIELD_SIZE = 64;
+
+ResultTable::ResultTable()
+    : timestamps(), groundSteering(), output(), withOutput(false)
+{
+}
+
+bool ResultTable::open(const std::string &path)
+{
+    timestamps.clear();
+    groundSteering.clear();
+    output.clear();
+    withOutput = false;
+
+    if (path.size() >= 4 && path.compare(path.size() - 4, 4, ".bin") == 0)
+    {
+        return readLog(path);
+    }
+
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        return false;
+    }
+    struct stat status;
+    if (::fstat(fd, &status) != 0 || status.st_size == 0)
+    {
+        ::close(fd);
+        return false;
+    }
+    const size_t size = static_cast<size_t>(status.st_size);
+    void *mapping = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED)
+    {
+        return false;
+    }
+    ::madvise(mapping, size, MADV_SEQUENTIAL);
+    const bool ok = readCsv(static_cast<const char *>(mapping), size);
+    ::munmap(mapping, size);
+    return ok;
+}
+
+size_t ResultTable::getRowCount() const
+{
+    return timestamps.size();
+}
+
+bool ResultTable::hasOutput() const
+{
+    return withOutput;
+}
+
+const std::vector<int64_t> &ResultTable::getTimestamps() const
+{
+    return timestamps;
+}
+
+const std::vector<double> &ResultTable::getGroundSteering() const
+{
+    return groundSteering;
+}
+
+const std::vector<double> &ResultTable::getOutput() const
+{
+    return output;
+}
+
+bool ResultTable::readLog(const std::string &path)
+{
+    ResultLogReader reader;
+    if (!reader.open(path))
+    {
+        return false;
+    }
+    timestamps.reserve(reader.getRowCount());
+    groundSteering.reserve(reader.getRowCount());
+    output.reserve(reader.getRowCount());
+    for (size_t i = 0; i < reader.getBlockCount(); i++)
+    {
+        const ResultLogBlock block = reader.getBlock(i);
+        timestamps.insert(timestamps.end(), block.timestamps, block.timestamps + block.rows);
+        groundSteering.insert(groundSteering.end(), block.ground, block.ground + block.rows);
+        output.insert(output.end(), block.output, block.output + block.rows);
+    }
+    withOutput = true;
+    return true;
+}
+
+bool ResultTable::readCsv(const char *text, size_t size)
+{
+    const char *end = text + size;
+    const char *line = text;
+
+    // Columns of the header line
+    const size_t NONE = std::numeric_limits<size_t>::max();
+    size_t timestampColumn = NONE;
+    size_t groundColumn = NONE;
+    size_t outputColumn = NONE;
+    const char *lineEnd = static_cast<const char *>(std::memchr(line, '\n', size));
+    if (lineEnd == nullptr)
+    {
+        lineEnd = end;
+    }
+    {
+        size_t column = 0;
+        const char *field = line;
+        while (field <= lineEnd)
+        {
+            const char *fieldEnd = field;
+            while (fieldEnd < lineEnd && *fieldEnd != ';' && *fieldEnd != '\r')
+            {
+                fieldEnd++;
+            }
+            const std::string name(field, fieldEnd);
+            if (name == "sampleTimeStamp")
+            {
+                timestampColumn = column;
+            }
+            else if (name == "groundSteering")
+            {
+                groundColumn = column;
+            }
+            else if (name == "output")
+            {
+                outputColumn = column;
+            }
+            if (fieldEnd >= lineEnd || *fieldEnd != ';')
+            {
+                break;
+            }
+            field = fieldEnd + 1;
+            column++;
+        }
+    }
+    if (timestampColumn == NONE || groundColumn == NONE)
+    {
+        return false;
+    }
+    withOutput = outputColumn != NONE;
+
+    // One row per line, empty lines are skipped and missing values are read as NaN like pandas reads them
+    char field[FIELD_SIZE];
+    line = (lineEnd < end) ? lineEnd + 1 : end;
+    while (line < end)
+    {
+        lineEnd = static_cast<const char *>(std::memchr(line, '\n', static_cast<size_t>(end - line)));
+        if (lineEnd == nullptr)
+        {
+            lineEnd = end;
+        }
+        const char *contentEnd = (lineEnd > line && *(lineEnd - 1) == '\r') ? lineEnd - 1 : lineEnd;
+        if (contentEnd > line)
+        {
+            int64_t timestamp = 0;
+            double ground = std::numeric_limits<double>::quiet_NaN();
+            double steering = std::numeric_limits<double>::quiet_NaN();
+
+            size_t column = 0;
+            const char *start = line;
+            while (start <= contentEnd)
+            {
+                const char *stop = static_cast<const char *>(std::memchr(start, ';', static_cast<size_t>(contentEnd - start)));
+                if (stop == nullptr)
+                {
+                    stop = contentEnd;
+                }
+                const size_t length = static_cast<size_t>(stop - start);
+                if (length > 0 && length < FIELD_SIZE && (column == timestampColumn || column == groundColumn || column == outputColumn))
+                {
+                    std::memcpy(field, start, length);
+                    field[length] = '\0';
+                    if (column == timestampColumn)
+                    {
+                        timestamp = std::strtoll(field, nullptr, 10);
+                    }
+                    else if (column == groundColumn)
+                    {
+                        ground = std::strtod(field, nullptr);
+                    }
+                    else
+                    {
+                        steering = std::strtod(field, nullptr);
+                    }
+                }
+                start = stop + 1;
+                column++;
+            }
+
+            timestamps.push_back(timestamp);
+            groundSteering.push_back(ground);
+            if (withOutput)
+            {
+                output.push_back(steering);
+            }
+        }
+        line = lineEnd + 1;
+    }
+    return true;
+}
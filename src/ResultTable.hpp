@@ -0,0 +1,38 @@
+#ifndef RESULT_TABLE_HPP
+#define RESULT_TABLE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Columns of an output file (the CSV file or the binary result log) or of an original*.csv file, read through a
+// memory mapping of the file. The CSV columns are found by the names in the header line and separated by ';' like
+// pandas reads them in the Python scripts; the float columns of a result log are widened to double like pandas does
+// when it iterates over the rows.
+class ResultTable {
+    public:
+        ResultTable();
+
+        // False if the file cannot be read or has no sampleTimeStamp or groundSteering column
+        bool open(const std::string &path);
+
+        size_t getRowCount() const;
+        bool hasOutput() const;
+
+        const std::vector<int64_t> &getTimestamps() const;
+        const std::vector<double> &getGroundSteering() const;
+        // Empty for an original*.csv file
+        const std::vector<double> &getOutput() const;
+
+    private:
+        bool readLog(const std::string &path);
+        bool readCsv(const char *text, size_t size);
+
+        std::vector<int64_t> timestamps;
+        std::vector<double> groundSteering;
+        std::vector<double> output;
+        bool withOutput;
+};
+
+#endif // RESULT_TABLE_HPP
@@ -0,0 +1,179 @@
+#include "ResultWriter.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+
+// Longest formatted line: a 20 digit timestamp, two doubles of at most 13 characters in %g format and the separators
+static const size_t MAX_LINE = 64;
+
+ResultWriter::ResultWriter(const std::string &csvPath, std::ostream &console)
+    : csv(csvPath), consoleStream(console), queue(QUEUE_CAPACITY), csvBuffer(BUFFER_SIZE), csvUsed(0), consoleBuffer(BUFFER_SIZE),
+      consoleUsed(0), log(), running(false), thread()
+{
+    csv << "sampleTimeStamp;groundSteering;output" << std::endl;
+}
+
+ResultWriter::~ResultWriter()
+{
+    stop();
+}
+
+bool ResultWriter::isOpen() const
+{
+    return csv.is_open();
+}
+
+bool ResultWriter::createLog(const std::string &logPath)
+{
+    return log.create(logPath);
+}
+
+void ResultWriter::start()
+{
+    running = true;
+    thread = std::thread(&ResultWriter::run, this);
+}
+
+void ResultWriter::stop()
+{
+    if (!running.exchange(false))
+    {
+        return;
+    }
+    if (thread.joinable())
+    {
+        thread.join();
+    }
+}
+
+void ResultWriter::write(const ResultLine &line)
+{
+    queue.push(line);
+}
+
+void ResultWriter::run()
+{
+    auto lastFlush = std::chrono::steady_clock::now();
+    uint32_t idleRounds = 0;
+    for (;;)
+    {
+        // Read the flag before the queue, so no line that was passed before stop is left behind
+        const bool stopping = !running;
+
+        ResultLine line;
+        if (queue.tryPop(line))
+        {
+            format(line);
+            idleRounds = 0;
+            continue;
+        }
+
+        if (stopping)
+        {
+            flush();
+            log.close();
+            return;
+        }
+
+        const auto now = std::chrono::steady_clock::now();
+        if ((csvUsed != 0 || consoleUsed != 0) && now - lastFlush >= std::chrono::milliseconds(FLUSH_INTERVAL_MS))
+        {
+            flush();
+            lastFlush = now;
+        }
+
+        // Nothing to do, yield a few times before sleeping until the next frame
+        if (idleRounds++ < 64)
+        {
+            std::this_thread::yield();
+        }
+        else
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+}
+
+void ResultWriter::format(const ResultLine &line)
+{
+    if (csvUsed + MAX_LINE > csvBuffer.size() || consoleUsed + MAX_LINE > consoleBuffer.size())
+    {
+        flush();
+    }
+
+    // group_18;<timestamp>;<output>
+    static const char GROUP[] = "group_18;";
+    char *out = consoleBuffer.data() + consoleUsed;
+    for (const char *c = GROUP; *c != '\0'; c++)
+    {
+        *out++ = *c;
+    }
+    out = appendInteger(out, line.timestamp);
+    *out++ = ';';
+    out = appendDouble(out, line.output);
+    *out++ = '\n';
+    consoleUsed = static_cast<size_t>(out - consoleBuffer.data());
+
+    // <timestamp>;<ground>;<output>
+    out = csvBuffer.data() + csvUsed;
+    out = appendInteger(out, line.timestamp);
+    *out++ = ';';
+    out = appendDouble(out, line.ground);
+    *out++ = ';';
+    out = appendDouble(out, line.output);
+    *out++ = '\n';
+    csvUsed = static_cast<size_t>(out - csvBuffer.data());
+
+    if (log.isOpen())
+    {
+        log.append(line.timestamp, line.ground, line.output);
+    }
+}
+
+void ResultWriter::flush()
+{
+    if (consoleUsed != 0)
+    {
+        consoleStream.write(consoleBuffer.data(), static_cast<std::streamsize>(consoleUsed));
+        consoleStream.flush();
+        consoleUsed = 0;
+    }
+    if (csvUsed != 0)
+    {
+        csv.write(csvBuffer.data(), static_cast<std::streamsize>(csvUsed));
+        csv.flush();
+        csvUsed = 0;
+    }
+    log.writeBlock();
+}
+
+char *ResultWriter::appendInteger(char *out, int64_t value)
+{
+    // Digits in reverse order, the magnitude is unsigned so that the smallest value does not overflow
+    char digits[20];
+    size_t count = 0;
+    uint64_t magnitude = (value < 0) ? 0 - static_cast<uint64_t>(value) : static_cast<uint64_t>(value);
+    do
+    {
+        digits[count++] = static_cast<char>('0' + magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude != 0);
+
+    if (value < 0)
+    {
+        *out++ = '-';
+    }
+    while (count != 0)
+    {
+        *out++ = digits[--count];
+    }
+    return out;
+}
+
+char *ResultWriter::appendDouble(char *out, double value)
+{
+    // Same format as an ostream with the default precision, so the files do not change
+    const int written = std::snprintf(out, MAX_LINE / 2, "%g", value);
+    return out + ((written > 0) ? std::min(static_cast<size_t>(written), MAX_LINE / 2 - 1) : 0);
+}
@@ -0,0 +1,75 @@
+#ifndef RESULT_WRITER_HPP
+#define RESULT_WRITER_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ResultLog.hpp"
+#include "SpscQueue.hpp"
+
+// One output line: the sample timestamp and original ground steering of a frame and the computed steering
+struct ResultLine {
+    int64_t timestamp{0};
+    double ground{0};
+    double output{0};
+};
+
+// Writes the output lines to the console and to the CSV file on its own thread, so a frame never waits for a flush.
+// The lines are passed through a lock-free queue and formatted into two large buffers, which are written when they
+// are almost full, when FLUSH_INTERVAL has passed since the last write, and when the writer is stopped. Optionally the
+// lines are also written to a binary result log, one block per write.
+class ResultWriter {
+    public:
+        ResultWriter(const std::string &csvPath, std::ostream &console);
+        ~ResultWriter();
+
+        ResultWriter(const ResultWriter &) = delete;
+        ResultWriter &operator=(const ResultWriter &) = delete;
+
+        // False if the CSV file could not be created
+        bool isOpen() const;
+
+        // Also writes the lines to a binary result log, must be called before start
+        bool createLog(const std::string &logPath);
+
+        void start();
+        // Writes all lines that were passed before
+        void stop();
+
+        // Only one thread may pass lines, it waits only while the queue is full
+        void write(const ResultLine &line);
+
+        static const size_t QUEUE_CAPACITY = 1024;
+        static const size_t BUFFER_SIZE = 64 * 1024;
+        static const int FLUSH_INTERVAL_MS = 100;
+
+    private:
+        void run();
+        void format(const ResultLine &line);
+        void flush();
+
+        static char *appendInteger(char *out, int64_t value);
+        static char *appendDouble(char *out, double value);
+
+        std::ofstream csv;
+        std::ostream &consoleStream;
+        SpscQueue<ResultLine> queue;
+
+        // Only used by the writer thread
+        std::vector<char> csvBuffer;
+        size_t csvUsed;
+        std::vector<char> consoleBuffer;
+        size_t consoleUsed;
+        ResultLogWriter log;
+
+        std::atomic<bool> running;
+        std::thread thread;
+};
+
+#endif // RESULT_WRITER_HPP
@@ -0,0 +1,280 @@
+#include "RunLengthLabeller.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+// Label 0 is unused, background label 1 is the area around the mask
+const int32_t OUTSIDE = 1;
+
+const uint64_t LOW_BITS = 0x0101010101010101ULL;
+const uint64_t HIGH_BITS = 0x8080808080808080ULL;
+
+inline uint64_t load8(const uint8_t *pixels)
+{
+    uint64_t word;
+    std::memcpy(&word, pixels, sizeof(word));
+    return word;
+}
+
+inline bool hasZeroByte(uint64_t word)
+{
+    return ((word - LOW_BITS) & ~word & HIGH_BITS) != 0;
+}
+
+// Gap k of a row lies between run k - 1 and run k, the first gap starts at 0 and the last one ends at the width
+inline int gapStart(const std::vector<MaskRun> &runs, size_t k)
+{
+    return (k == 0) ? 0 : runs[k - 1].end;
+}
+
+inline int gapEnd(const std::vector<MaskRun> &runs, size_t k, int width)
+{
+    return (k == runs.size()) ? width : runs[k].start;
+}
+
+} // namespace
+
+RunLengthLabeller::RunLengthLabeller()
+    : components(), backgroundParent(), outside(), previousRuns(), currentRuns(), previousGaps(), currentGaps()
+{
+}
+
+void RunLengthLabeller::encodeRow(const uint8_t *row, int width, std::vector<MaskRun> &runs)
+{
+    int x = 0;
+    while (x < width)
+    {
+        while (x + 8 <= width && load8(row + x) == 0)
+        {
+            x += 8;
+        }
+        while (x < width && row[x] == 0)
+        {
+            x++;
+        }
+        if (x == width)
+        {
+            break;
+        }
+
+        MaskRun run;
+        run.start = x;
+        while (x + 8 <= width && !hasZeroByte(load8(row + x)))
+        {
+            x += 8;
+        }
+        while (x < width && row[x] != 0)
+        {
+            x++;
+        }
+        run.end = x;
+        runs.push_back(run);
+    }
+}
+
+int32_t RunLengthLabeller::findForeground(int32_t label)
+{
+    while (components[static_cast<size_t>(label)].parent != label)
+    {
+        Component &component = components[static_cast<size_t>(label)];
+        component.parent = components[static_cast<size_t>(component.parent)].parent;
+        label = component.parent;
+    }
+    return label;
+}
+
+int32_t RunLengthLabeller::findBackground(int32_t label)
+{
+    while (backgroundParent[static_cast<size_t>(label)] != label)
+    {
+        int32_t &parent = backgroundParent[static_cast<size_t>(label)];
+        parent = backgroundParent[static_cast<size_t>(parent)];
+        label = parent;
+    }
+    return label;
+}
+
+int32_t RunLengthLabeller::mergeForeground(int32_t first, int32_t second)
+{
+    first = findForeground(first);
+    second = findForeground(second);
+    if (first == second)
+    {
+        return first;
+    }
+
+    // The older label stays the root, so the root is always the first run of the blob in raster order
+    if (second < first)
+    {
+        std::swap(first, second);
+    }
+    Component &root = components[static_cast<size_t>(first)];
+    Component &child = components[static_cast<size_t>(second)];
+    child.parent = first;
+    if (child.minX < root.minX)
+    {
+        root.minX = child.minX;
+        root.leftGap = child.leftGap;
+    }
+    root.minY = std::min(root.minY, child.minY);
+    root.maxX = std::max(root.maxX, child.maxX);
+    root.maxY = std::max(root.maxY, child.maxY);
+    root.area += child.area;
+    root.sumX += child.sumX;
+    root.sumY += child.sumY;
+    return first;
+}
+
+int32_t RunLengthLabeller::mergeBackground(int32_t first, int32_t second)
+{
+    first = findBackground(first);
+    second = findBackground(second);
+    if (first == second)
+    {
+        return first;
+    }
+    if (second < first)
+    {
+        std::swap(first, second);
+    }
+    backgroundParent[static_cast<size_t>(second)] = first;
+    outside[static_cast<size_t>(first)] |= outside[static_cast<size_t>(second)];
+    return first;
+}
+
+void RunLengthLabeller::addRun(int32_t label, const MaskRun &run, int y, int32_t leftGap)
+{
+    Component &component = components[static_cast<size_t>(label)];
+    const uint64_t length = static_cast<uint64_t>(run.end - run.start);
+    if (run.start < component.minX)
+    {
+        component.minX = run.start;
+        component.leftGap = leftGap;
+    }
+    component.maxX = std::max(component.maxX, run.end - 1);
+    component.maxY = y;
+    component.area += length;
+    component.sumX += length * static_cast<uint64_t>(run.start + run.end - 1) / 2;
+    component.sumY += length * static_cast<uint64_t>(y);
+}
+
+void RunLengthLabeller::labelGaps(int width, bool borderRow)
+{
+    currentGaps.assign(currentRuns.size() + 1, 0);
+
+    // Background is 4-connected, so a gap joins the gaps above it that share at least one column
+    size_t above = 0;
+    for (size_t k = 0; k <= currentRuns.size(); k++)
+    {
+        const int start = gapStart(currentRuns, k);
+        const int end = gapEnd(currentRuns, k, width);
+        if (start == end)
+        {
+            continue;
+        }
+
+        int32_t label = 0;
+        while (above < previousGaps.size() && gapEnd(previousRuns, above, width) <= start)
+        {
+            above++;
+        }
+        for (size_t j = above; j < previousGaps.size() && gapStart(previousRuns, j) < end; j++)
+        {
+            if (previousGaps[j] != 0)
+            {
+                label = (label == 0) ? findBackground(previousGaps[j]) : mergeBackground(label, previousGaps[j]);
+            }
+        }
+        if (label == 0)
+        {
+            label = static_cast<int32_t>(backgroundParent.size());
+            backgroundParent.push_back(label);
+            outside.push_back(0);
+        }
+        if (borderRow || start == 0 || end == width)
+        {
+            label = mergeBackground(label, OUTSIDE);
+        }
+        currentGaps[k] = label;
+    }
+}
+
+size_t RunLengthLabeller::label(const uint8_t *pixels, size_t step, int width, int height, const BlobLabeller::Filter &filter, std::vector<BlobStats> &blobs)
+{
+    blobs.clear();
+    components.assign(1, Component{0, 0, 0, 0, 0, 0, 0, 0, 0});
+    backgroundParent.assign(2, 0);
+    backgroundParent[OUTSIDE] = OUTSIDE;
+    outside.assign(2, 0);
+    outside[OUTSIDE] = 1;
+
+    // The row above the mask is one gap of background around the mask
+    previousRuns.clear();
+    previousGaps.assign(1, OUTSIDE);
+
+    for (int y = 0; y < height; y++)
+    {
+        currentRuns.clear();
+        encodeRow(pixels + static_cast<size_t>(y) * step, width, currentRuns);
+        labelGaps(width, y == height - 1);
+
+        // Foreground is 8-connected, so a run joins the runs above it that share a column or touch it diagonally
+        size_t above = 0;
+        for (size_t k = 0; k < currentRuns.size(); k++)
+        {
+            MaskRun &run = currentRuns[k];
+            int32_t label = 0;
+            while (above < previousRuns.size() && previousRuns[above].end < run.start)
+            {
+                above++;
+            }
+            for (size_t j = above; j < previousRuns.size() && previousRuns[j].start <= run.end; j++)
+            {
+                label = (label == 0) ? findForeground(previousRuns[j].label) : mergeForeground(label, previousRuns[j].label);
+            }
+            if (label == 0)
+            {
+                label = static_cast<int32_t>(components.size());
+                components.push_back(Component{label, run.start, y, run.start, y, 0, 0, 0, currentGaps[k]});
+            }
+            addRun(label, run, y, currentGaps[k]);
+            run.label = label;
+        }
+
+        std::swap(previousRuns, currentRuns);
+        std::swap(previousGaps, currentGaps);
+    }
+
+    // The background left of the leftmost pixel of a blob surrounds the blob, the blob is inside a hole of another
+    // blob when that background does not reach the border
+    size_t count = 0;
+    for (size_t i = 1; i < components.size(); i++)
+    {
+        const Component &component = components[i];
+        if (component.parent != static_cast<int32_t>(i))
+        {
+            continue;
+        }
+        if (component.leftGap != 0 && outside[static_cast<size_t>(findBackground(component.leftGap))] == 0)
+        {
+            continue;
+        }
+        count++;
+
+        BlobStats blob;
+        blob.x = component.minX;
+        blob.y = component.minY;
+        blob.width = component.maxX - component.minX + 1;
+        blob.height = component.maxY - component.minY + 1;
+        blob.area = component.area;
+        blob.centroidX = static_cast<double>(component.sumX) / static_cast<double>(component.area);
+        blob.centroidY = static_cast<double>(component.sumY) / static_cast<double>(component.area);
+        if (!filter || filter(blob))
+        {
+            blobs.push_back(blob);
+        }
+    }
+    return count;
+}
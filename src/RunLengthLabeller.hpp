@@ -0,0 +1,67 @@
+#ifndef RUN_LENGTH_LABELLER_HPP
+#define RUN_LENGTH_LABELLER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "BlobLabeller.hpp"
+
+// Horizontal run of foreground pixels [start, end) in one row of a mask
+struct MaskRun {
+    int start{0};
+    int end{0};
+    int32_t label{0};
+};
+
+// Blob labeller that works on runs instead of pixels. Every row is encoded as its runs of foreground pixels, and the
+// runs are merged with the runs of the previous row with union-find, so apart from finding the runs in a row the cost
+// grows with the number of runs. The gaps between the runs are merged the same way to know which background
+// touches the border of the mask: a blob whose leftmost pixel is next to that background is not inside another
+// blob, which gives the same set of blobs as cv::findContours with cv::RETR_EXTERNAL.
+class RunLengthLabeller {
+    public:
+        RunLengthLabeller();
+
+        // Appends the runs of a row, zero bytes are skipped 8 at a time
+        static void encodeRow(const uint8_t *row, int width, std::vector<MaskRun> &runs);
+
+        // Blobs that pass the filter, in the order of their first pixel. Returns the number of blobs before the filter.
+        size_t label(const uint8_t *pixels, size_t step, int width, int height, const BlobLabeller::Filter &filter, std::vector<BlobStats> &blobs);
+
+    private:
+        // Foreground component, the merged statistics are kept at the root
+        struct Component {
+            int32_t parent;
+            int minX;
+            int minY;
+            int maxX;
+            int maxY;
+            size_t area;
+            uint64_t sumX;
+            uint64_t sumY;
+            // Background left of the leftmost pixel, 0 when the blob touches the left border
+            int32_t leftGap;
+        };
+
+        int32_t findForeground(int32_t label);
+        int32_t findBackground(int32_t label);
+        int32_t mergeForeground(int32_t first, int32_t second);
+        int32_t mergeBackground(int32_t first, int32_t second);
+        void addRun(int32_t label, const MaskRun &run, int y, int32_t leftGap);
+
+        // Labels the gaps around the runs of the current row, a gap between two runs is never empty
+        void labelGaps(int width, bool borderRow);
+
+        std::vector<Component> components;
+        std::vector<int32_t> backgroundParent;
+        std::vector<uint8_t> outside;
+
+        // Runs of the previous and the current row, and the labels of the gaps before, between and after the runs
+        std::vector<MaskRun> previousRuns;
+        std::vector<MaskRun> currentRuns;
+        std::vector<int32_t> previousGaps;
+        std::vector<int32_t> currentGaps;
+};
+
+#endif // RUN_LENGTH_LABELLER_HPP
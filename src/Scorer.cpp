@@ -0,0 +1,118 @@
+/*
+ * Copyright (C) 2024 Christian Berger, Ionel Pop, Adrian Hassa,
+ *                        Teodora Portase, Vasilena Karaivanova
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Scores the output of the microservice like compare_data.py, without going through pandas row by row. The output
+// file and the original*.csv file are mapped into memory, joined on sampleTimeStamp and scored column by column.
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "ResultTable.hpp"
+#include "SteeringScore.hpp"
+
+// The percentage as Python prints round(percentage, 2): rounded to two decimals, without trailing zeros but with at
+// least one decimal
+static std::string formatPercentage(double percentage)
+{
+    char text[64];
+    std::snprintf(text, sizeof(text), "%.2f", percentage);
+    std::string formatted{text};
+    while (formatted.size() > 1 && formatted.back() == '0' && formatted[formatted.size() - 2] != '.')
+    {
+        formatted.pop_back();
+    }
+    return formatted;
+}
+
+int32_t main(int32_t argc, char **argv)
+{
+    if (argc < 2 || argc > 3)
+    {
+        std::cerr << argv[0] << " computes the percentage of output lines within +/- 25% of the ground steering." << std::endl;
+        std::cerr << "Usage:   " << argv[0] << " <output.csv or result log .bin> [original.csv]" << std::endl;
+        std::cerr << "         without original.csv the groundSteering column of the output is used like compare_data.py does," << std::endl;
+        std::cerr << "         with it the lines are joined on sampleTimeStamp and its groundSteering column is used" << std::endl;
+        std::cerr << "Example: " << argv[0] << " /tmp/output.csv recordings/original1.csv" << std::endl;
+        return 1;
+    }
+
+    ResultTable current;
+    if (!current.open(argv[1]) || !current.hasOutput())
+    {
+        std::cerr << argv[0] << ": Cannot read the output lines of '" << argv[1] << "'." << std::endl;
+        return 1;
+    }
+
+    SteeringScore score;
+    if (argc == 2)
+    {
+        score.addColumns(current.getGroundSteering().data(), current.getOutput().data(), current.getRowCount());
+    }
+    else
+    {
+        ResultTable original;
+        if (!original.open(argv[2]))
+        {
+            std::cerr << argv[0] << ": Cannot read the ground steering of '" << argv[2] << "'." << std::endl;
+            return 1;
+        }
+
+        // Inner join: every output line with every original line of the same timestamp, the original lines are
+        // sorted once and searched per output line
+        const std::vector<int64_t> &originalTimestamps = original.getTimestamps();
+        std::vector<size_t> order(original.getRowCount());
+        for (size_t i = 0; i < order.size(); i++)
+        {
+            order[i] = i;
+        }
+        std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+            return originalTimestamps[a] < originalTimestamps[b];
+        });
+
+        std::vector<double> ground;
+        std::vector<double> output;
+        ground.reserve(current.getRowCount());
+        output.reserve(current.getRowCount());
+        for (size_t row = 0; row < current.getRowCount(); row++)
+        {
+            const int64_t timestamp = current.getTimestamps()[row];
+            auto match = std::lower_bound(order.begin(), order.end(), timestamp, [&](size_t index, int64_t value) {
+                return originalTimestamps[index] < value;
+            });
+            for (; match != order.end() && originalTimestamps[*match] == timestamp; ++match)
+            {
+                ground.push_back(original.getGroundSteering()[*match]);
+                output.push_back(current.getOutput()[row]);
+            }
+        }
+        score.addColumns(ground.data(), output.data(), ground.size());
+    }
+
+    if (score.getDataPoints() == 0)
+    {
+        std::cerr << argv[0] << ": No line with a ground steering other than 0." << std::endl;
+        return 1;
+    }
+    std::cout << "Percentage:  " << formatPercentage(score.getPercentage()) << " %" << std::endl;
+    std::cout << "Valid: " << score.getValid() << " of " << score.getDataPoints() << " data points" << std::endl;
+    return 0;
+}
@@ -0,0 +1,99 @@
+#include "SensorHistory.hpp"
+
+#include <algorithm>
+
+SensorHistory::SensorHistory(size_t sampleCapacity)
+    : capacity(std::max<size_t>(sampleCapacity, 2)), samples(new Sample[capacity]), first(0), started(0), finished(0)
+{
+    for (size_t i = 0; i < capacity; i++)
+    {
+        samples[i].timestamp.store(0, std::memory_order_relaxed);
+        samples[i].value.store(0, std::memory_order_relaxed);
+    }
+}
+
+void SensorHistory::add(int64_t timestamp, double value)
+{
+    const uint64_t index = finished.load(std::memory_order_relaxed);
+    if (index > first.load(std::memory_order_relaxed) && timestamp < sample(index - 1).timestamp.load(std::memory_order_relaxed))
+    {
+        first.store(index, std::memory_order_release);
+    }
+
+    // Announce the slot before it is overwritten, a reader that sees the new sample also sees the announcement
+    started.store(index + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    Sample &slot = samples[index % capacity];
+    slot.timestamp.store(timestamp, std::memory_order_relaxed);
+    slot.value.store(value, std::memory_order_relaxed);
+    finished.store(index + 1, std::memory_order_release);
+}
+
+bool SensorHistory::valueAt(int64_t timestamp, double &value) const
+{
+    for (;;)
+    {
+        const uint64_t end = finished.load(std::memory_order_acquire);
+        const uint64_t begin = std::max(first.load(std::memory_order_acquire), (end > capacity) ? end - capacity : 0);
+        if (begin >= end)
+        {
+            return false;
+        }
+
+        // First sample at or after the timestamp
+        uint64_t low = begin;
+        uint64_t high = end;
+        while (low < high)
+        {
+            const uint64_t middle = low + (high - low) / 2;
+            if (sample(middle).timestamp.load(std::memory_order_relaxed) < timestamp)
+            {
+                low = middle + 1;
+            }
+            else
+            {
+                high = middle;
+            }
+        }
+
+        double result;
+        if (low == end)
+        {
+            result = sample(end - 1).value.load(std::memory_order_relaxed);
+        }
+        else if (low == begin)
+        {
+            result = sample(begin).value.load(std::memory_order_relaxed);
+        }
+        else
+        {
+            const int64_t beforeTimestamp = sample(low - 1).timestamp.load(std::memory_order_relaxed);
+            const int64_t afterTimestamp = sample(low).timestamp.load(std::memory_order_relaxed);
+            const double before = sample(low - 1).value.load(std::memory_order_relaxed);
+            const double after = sample(low).value.load(std::memory_order_relaxed);
+            const double fraction = (afterTimestamp > beforeTimestamp)
+                ? static_cast<double>(timestamp - beforeTimestamp) / static_cast<double>(afterTimestamp - beforeTimestamp) : 1.0;
+            result = before + (after - before) * fraction;
+        }
+
+        // The writer announces every slot before overwriting it, so if no sample since begin was started again the
+        // samples above were read whole
+        std::atomic_thread_fence(std::memory_order_acquire);
+        const uint64_t overwritten = started.load(std::memory_order_relaxed);
+        if (overwritten <= begin + capacity)
+        {
+            value = result;
+            return true;
+        }
+    }
+}
+
+size_t SensorHistory::getCapacity() const
+{
+    return capacity;
+}
+
+const SensorHistory::Sample &SensorHistory::sample(uint64_t index) const
+{
+    return samples[index % capacity];
+}
@@ -0,0 +1,48 @@
+#ifndef SENSOR_HISTORY_HPP
+#define SENSOR_HISTORY_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+// The last samples of one sensor value with the sample timestamps of their envelopes, so that a frame can use the
+// value at its own timestamp instead of the value that happened to arrive last. The samples are kept in a ring of
+// fixed capacity for exactly one writer thread and one reader thread; neither of them ever waits for the other; a
+// reader whose samples were overwritten while it looked at them simply looks again.
+class SensorHistory {
+    public:
+        explicit SensorHistory(size_t sampleCapacity);
+
+        SensorHistory(const SensorHistory &) = delete;
+        SensorHistory &operator=(const SensorHistory &) = delete;
+
+        // Writer side, the timestamps are in microseconds. A timestamp older than the previous one starts a new
+        // history, which happens when a recording is played again.
+        void add(int64_t timestamp, double value);
+
+        // Reader side: the value at the timestamp, interpolated linearly between the two samples around it with a
+        // binary search, and the value of the oldest or newest sample outside of them. False while no sample was added.
+        bool valueAt(int64_t timestamp, double &value) const;
+
+        size_t getCapacity() const;
+
+    private:
+        struct Sample {
+            std::atomic<int64_t> timestamp;
+            std::atomic<double> value;
+        };
+
+        const Sample &sample(uint64_t index) const;
+
+        size_t capacity;
+        std::unique_ptr<Sample[]> samples;
+
+        // Index of the oldest sample of the current history, and how many samples were started and finished; the
+        // slot of a sample is its index modulo the capacity
+        std::atomic<uint64_t> first;
+        std::atomic<uint64_t> started;
+        std::atomic<uint64_t> finished;
+};
+
+#endif // SENSOR_HISTORY_HPP
@@ -0,0 +1,140 @@
+#ifndef SPSC_QUEUE_HPP
+#define SPSC_QUEUE_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+// Bounded lock-free queue for exactly one producer thread and one consumer thread. The producer only writes the
+// tail and the consumer only writes the head, so neither ever takes a lock. push and pop wait while the queue is
+// full or empty, first by yielding and then by short sleeps, and count how often they had to wait.
+template <typename T>
+class SpscQueue {
+    public:
+        explicit SpscQueue(size_t queueCapacity)
+            : items(queueCapacity), head(0), headPadding(), tail(0), tailPadding(), maxDepth(0), fullStalls(0), emptyStalls(0)
+        {
+        }
+
+        SpscQueue(const SpscQueue &) = delete;
+        SpscQueue &operator=(const SpscQueue &) = delete;
+
+        // Producer side
+        bool tryPush(const T &value)
+        {
+            const size_t currentTail = tail.load(std::memory_order_relaxed);
+            const size_t depth = currentTail - head.load(std::memory_order_acquire);
+            if (depth == items.size())
+            {
+                return false;
+            }
+            items[currentTail % items.size()] = value;
+            tail.store(currentTail + 1, std::memory_order_release);
+            if (depth + 1 > maxDepth.load(std::memory_order_relaxed))
+            {
+                maxDepth.store(depth + 1, std::memory_order_relaxed);
+            }
+            return true;
+        }
+
+        void push(const T &value)
+        {
+            if (tryPush(value))
+            {
+                return;
+            }
+            fullStalls.fetch_add(1, std::memory_order_relaxed);
+            for (uint32_t attempt = 0; !tryPush(value); attempt++)
+            {
+                backOff(attempt);
+            }
+        }
+
+        // Consumer side
+        bool tryPop(T &value)
+        {
+            const size_t currentHead = head.load(std::memory_order_relaxed);
+            if (currentHead == tail.load(std::memory_order_acquire))
+            {
+                return false;
+            }
+            value = items[currentHead % items.size()];
+            head.store(currentHead + 1, std::memory_order_release);
+            return true;
+        }
+
+        T pop()
+        {
+            T value{};
+            if (tryPop(value))
+            {
+                return value;
+            }
+            emptyStalls.fetch_add(1, std::memory_order_relaxed);
+            for (uint32_t attempt = 0; !tryPop(value); attempt++)
+            {
+                backOff(attempt);
+            }
+            return value;
+        }
+
+        // Statistics, may be read from any thread
+        size_t getCapacity() const
+        {
+            return items.size();
+        }
+
+        size_t getDepth() const
+        {
+            return tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire);
+        }
+
+        size_t getMaxDepth() const
+        {
+            return maxDepth.load(std::memory_order_relaxed);
+        }
+
+        // How often the producer found the queue full
+        uint64_t getFullStalls() const
+        {
+            return fullStalls.load(std::memory_order_relaxed);
+        }
+
+        // How often the consumer found the queue empty
+        uint64_t getEmptyStalls() const
+        {
+            return emptyStalls.load(std::memory_order_relaxed);
+        }
+
+    private:
+        static void backOff(uint32_t attempt)
+        {
+            if (attempt < 64)
+            {
+                std::this_thread::yield();
+            }
+            else
+            {
+                std::this_thread::sleep_for(std::chrono::microseconds(100));
+            }
+        }
+
+        static const size_t CACHE_LINE = 64;
+
+        std::vector<T> items;
+
+        // Head and tail on their own cache lines, as they are written by different threads
+        std::atomic<size_t> head;
+        char headPadding[CACHE_LINE - sizeof(std::atomic<size_t>)];
+        std::atomic<size_t> tail;
+        char tailPadding[CACHE_LINE - sizeof(std::atomic<size_t>)];
+
+        std::atomic<size_t> maxDepth;
+        std::atomic<uint64_t> fullStalls;
+        std::atomic<uint64_t> emptyStalls;
+};
+
+#endif // SPSC_QUEUE_HPP
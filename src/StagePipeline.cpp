@@ -0,0 +1,127 @@
+#include "StagePipeline.hpp"
+
+#include <chrono>
+#include <limits>
+
+namespace {
+
+// Passed on instead of a slot once the source has ended
+const size_t END_OF_STREAM = std::numeric_limits<size_t>::max();
+
+} // namespace
+
+StagePipeline::StagePipeline(size_t slotCount)
+    : slots(slotCount), stages(), queues(), threads()
+{
+}
+
+StagePipeline::~StagePipeline()
+{
+    for (std::thread &thread : threads)
+    {
+        if (thread.joinable())
+        {
+            thread.join();
+        }
+    }
+}
+
+void StagePipeline::setSource(const std::string &name, const Source &source)
+{
+    std::unique_ptr<StageInfo> info{new StageInfo{name, source, Stage(), {0}, {0}}};
+    stages.insert(stages.begin(), std::move(info));
+}
+
+void StagePipeline::addStage(const std::string &name, const Stage &stage)
+{
+    std::unique_ptr<StageInfo> info{new StageInfo{name, Source(), stage, {0}, {0}}};
+    stages.push_back(std::move(info));
+}
+
+void StagePipeline::run()
+{
+    // Every queue can hold all slots and the end marker, so pushing only waits when a slot is really missing
+    queues.clear();
+    for (size_t i = 0; i < stages.size(); i++)
+    {
+        queues.emplace_back(new SpscQueue<size_t>{slots + 1});
+    }
+    for (size_t slot = 0; slot < slots; slot++)
+    {
+        queues.front()->push(slot);
+    }
+
+    for (size_t i = 0; i + 1 < stages.size(); i++)
+    {
+        threads.emplace_back(&StagePipeline::runStage, this, i);
+    }
+    runStage(stages.size() - 1);
+
+    for (std::thread &thread : threads)
+    {
+        thread.join();
+    }
+    threads.clear();
+}
+
+void StagePipeline::runStage(size_t index)
+{
+    StageInfo &info = *stages[index];
+    SpscQueue<size_t> &input = *queues[index];
+    SpscQueue<size_t> &output = *queues[(index + 1) % queues.size()];
+    const bool last = (index + 1 == stages.size());
+
+    while (true)
+    {
+        const size_t slot = input.pop();
+        if (slot == END_OF_STREAM)
+        {
+            if (!last)
+            {
+                output.push(END_OF_STREAM);
+            }
+            return;
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        bool ended = false;
+        if (info.source)
+        {
+            ended = !info.source(slot);
+        }
+        else
+        {
+            info.stage(slot);
+        }
+        info.busyNanoseconds += static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+        info.frames++;
+
+        if (ended)
+        {
+            output.push(END_OF_STREAM);
+            return;
+        }
+        output.push(slot);
+    }
+}
+
+void StagePipeline::printStats(std::ostream &out) const
+{
+    for (size_t i = 0; i < stages.size(); i++)
+    {
+        const StageInfo &info = *stages[i];
+        const uint64_t frames = info.frames;
+        out << info.name << ": " << ((frames != 0) ? static_cast<double>(info.busyNanoseconds) / 1000.0 / static_cast<double>(frames) : 0)
+            << " us per frame";
+        if (i < queues.size())
+        {
+            // The queue in front of the stage, for the source this is the queue of free slots
+            const SpscQueue<size_t> &queue = *queues[i];
+            out << ", queue depth " << queue.getDepth() << " (max " << queue.getMaxDepth() << "), waited " << queue.getEmptyStalls()
+                << " times for a frame";
+            const SpscQueue<size_t> &next = *queues[(i + 1) % queues.size()];
+            out << " and " << next.getFullStalls() << " times to pass one on";
+        }
+        out << ((i + 1 < stages.size()) ? "; " : "");
+    }
+}
@@ -0,0 +1,61 @@
+#ifndef STAGE_PIPELINE_HPP
+#define STAGE_PIPELINE_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "SpscQueue.hpp"
+
+// Runs the steps of a frame as a pipeline. Every stage has its own thread and works on a different frame at the same
+// time, so the throughput is limited by the slowest stage instead of the sum of all stages. The frames are slots
+// that the caller owns, only their indices are passed on through bounded SPSC queues: from the source through every
+// stage and from the last stage back to the source, which limits the frames in flight to the number of slots.
+class StagePipeline {
+    public:
+        // The source fills a free slot and returns false at the end of the stream, the slot is then not passed on
+        using Source = std::function<bool(size_t slot)>;
+        using Stage = std::function<void(size_t slot)>;
+
+        explicit StagePipeline(size_t slotCount);
+        ~StagePipeline();
+
+        StagePipeline(const StagePipeline &) = delete;
+        StagePipeline &operator=(const StagePipeline &) = delete;
+
+        void setSource(const std::string &name, const Source &source);
+        void addStage(const std::string &name, const Stage &stage);
+
+        // Starts the source and every stage but the last one on their own threads and runs the last stage on the
+        // calling thread, which may be the only thread that can display images. Returns once the source has ended and
+        // all frames before the end have passed the last stage.
+        void run();
+
+        // Busy time per frame of every stage, and depth and stalls of every queue
+        void printStats(std::ostream &out) const;
+
+    private:
+        struct StageInfo {
+            std::string name;
+            Source source;
+            Stage stage;
+            std::atomic<uint64_t> frames;
+            std::atomic<uint64_t> busyNanoseconds;
+        };
+
+        void runStage(size_t index);
+
+        size_t slots;
+        std::vector<std::unique_ptr<StageInfo>> stages;
+        // Queue i leads into stage i, queue 0 carries the free slots from the last stage back to the source
+        std::vector<std::unique_ptr<SpscQueue<size_t>>> queues;
+        std::vector<std::thread> threads;
+};
+
+#endif // STAGE_PIPELINE_HPP
@@ -0,0 +1,34 @@
+#include "SteeringDelay.hpp"
+
+SteeringDelay::SteeringDelay(size_t frames)
+    : records(frames), next(0), count(0)
+{
+}
+
+bool SteeringDelay::push(const DelayedSteering &current, DelayedSteering &delayed)
+{
+    if (records.empty())
+    {
+        delayed = current;
+        return true;
+    }
+
+    if (count < records.size())
+    {
+        records[next] = current;
+        next = (next + 1) % records.size();
+        count++;
+        return false;
+    }
+
+    // The oldest record leaves the ring and the current one takes its slot
+    delayed = records[next];
+    records[next] = current;
+    next = (next + 1) % records.size();
+    return true;
+}
+
+size_t SteeringDelay::getDelayFrames() const
+{
+    return records.size();
+}
@@ -0,0 +1,33 @@
+#ifndef STEERING_DELAY_HPP
+#define STEERING_DELAY_HPP
+
+#include <cstddef>
+#include <ctime>
+#include <vector>
+
+// Sample timestamp and original ground steering of a frame
+struct DelayedSteering {
+    std::time_t timestamp{0};
+    double ground{0};
+};
+
+// Delays the values of the frames by a fixed number of frames. The records are kept in one ring that is allocated
+// once for the number of frames, so delaying a frame never allocates and reads and writes a single array.
+class SteeringDelay {
+    public:
+        explicit SteeringDelay(size_t frames);
+
+        // Adds the values of the current frame and returns the values of the frame that was added the given number of
+        // frames before; false for the first frames, whose values are only stored
+        bool push(const DelayedSteering &current, DelayedSteering &delayed);
+
+        size_t getDelayFrames() const;
+
+    private:
+        std::vector<DelayedSteering> records;
+        // Slot of the oldest record once the ring is full, and how many records are stored
+        size_t next;
+        size_t count;
+};
+
+#endif // STEERING_DELAY_HPP
@@ -0,0 +1,116 @@
+#include "SteeringEstimator.hpp"
+
+constexpr double SteeringEstimator::MAX_STEERING;
+constexpr double SteeringEstimator::MIN_STEERING;
+
+SteeringEstimator::SteeringEstimator(size_t delayFrames, bool interpolateSensors)
+    : interpolate(interpolateSensors), angularDivisor(86), ground(), angularVelocity(), angularHistory(SENSOR_HISTORY_CAPACITY),
+      previousTimeStamp(0), isForward(true), frameCounter(0), steeringDelay(delayFrames)
+{
+}
+
+void SteeringEstimator::setAngularDivisor(double divisor)
+{
+    angularDivisor = divisor;
+}
+
+void SteeringEstimator::addGroundSteering(float groundSteering)
+{
+    ground.store(groundSteering);
+}
+
+void SteeringEstimator::addAngularVelocity(int64_t sampleTimeStamp, float angularVelocityZ)
+{
+    angularHistory.add(sampleTimeStamp, angularVelocityZ);
+    angularVelocity.store(angularVelocityZ);
+}
+
+SteeringResult SteeringEstimator::estimate(bool hasTimeStamp, int64_t sampleTimeStamp)
+{
+    SteeringResult steering;
+
+    // TimeStamp variable
+    std::time_t currentTimeStamp = 0;
+    if (hasTimeStamp)
+    {
+        currentTimeStamp = sampleTimeStamp;
+    }
+    steering.currentTimeStamp = currentTimeStamp;
+
+    // Check if the video is played forwards or backwards
+    // After frame 2, we determine the direction and we proceed with the rest of the steps
+    // We assume that it's going forward at first
+    if (frameCounter < 1)
+    {
+        frameCounter++;
+        previousTimeStamp = currentTimeStamp;
+    }
+    else if (frameCounter == 1)
+    {
+        if (previousTimeStamp < currentTimeStamp)
+        {
+            isForward = true;
+        }
+        else
+        {
+            isForward = false;
+        }
+    }
+
+    // Latest received ground steering, the cell never waits for the receiver thread
+    steering.ground = ground.load();
+
+    // Angular velocity data
+    steering.angular = angularVelocity.load();
+
+    // The angular velocity at the timestamp of the frame, the latest value is kept until the first messages arrived.
+    // The ground steering stays the received value, it is the reference the output is scored against.
+    const bool aligned = interpolate && hasTimeStamp;
+    if (aligned)
+    {
+        double value;
+        if (angularHistory.valueAt(currentTimeStamp, value))
+        {
+            steering.angular = value;
+        }
+    }
+
+    // Divide the angular velocity by approximately 100 and multiply by 0.3
+    // The minimum and maximum values for angularVelocityZ are -101.2573 and 111.0229
+    // The values are different than exactly 100, so we divide by 100 -(-1+11) = 90
+    // However, after playing around with that value, we found that 86 has the best accuracy
+    double output = (steering.angular / angularDivisor) * 0.3;
+
+    // Clip the output ground steering angle
+    if (output > MAX_STEERING)
+        output = MAX_STEERING;
+    else if (output < MIN_STEERING)
+        output = MIN_STEERING;
+    steering.output = output;
+
+    // If the video is playing forward, we delay the output by the delay frames
+    // If the video is playing backwards, or the values belong to the frame already, we output the values immediately
+    if (isForward == true && !aligned)
+    {
+        // The first frames only fill the delay ring and have no line
+        DelayedSteering current;
+        current.timestamp = currentTimeStamp;
+        current.ground = steering.ground;
+        DelayedSteering delayed;
+        if (steeringDelay.push(current, delayed))
+        {
+            steering.hasLine = true;
+            steering.lineTimeStamp = delayed.timestamp;
+            steering.lineGround = delayed.ground;
+        }
+    }
+    else
+    {
+        steering.hasLine = true;
+        steering.lineTimeStamp = currentTimeStamp;
+        steering.lineGround = steering.ground;
+    }
+    // Update the previous timestamp variable
+    previousTimeStamp = currentTimeStamp;
+    return steering;
+}
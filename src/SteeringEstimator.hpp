@@ -0,0 +1,77 @@
+#ifndef STEERING_ESTIMATOR_HPP
+#define STEERING_ESTIMATOR_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+
+#include "LatestValue.hpp"
+#include "SensorHistory.hpp"
+#include "SteeringDelay.hpp"
+
+// Steering output of a frame, and the line that is written for it once the delay ring lets it out
+struct SteeringResult {
+    float ground{0};     // Original GroundSteeringRequest we want to match
+    double angular{0};   // AngularVelocity gotten from sensor data
+    std::time_t currentTimeStamp{0};
+    double output{0};
+    bool hasLine{false};
+    std::time_t lineTimeStamp{0};
+    double lineGround{0};
+};
+
+// Parameters of the steering output, see SteeringEstimator
+struct SteeringSettings {
+    double angularDivisor{86};
+    size_t delayFrames{2};
+    bool interpolateSensors{false};
+};
+
+// Computes the steering output of the frames from the angular velocity. The sensor values are passed by the thread that
+// receives them and read by the thread that steers without either of them waiting; the direction of the video and the
+// delay ring carry over from frame to frame, so the frames have to be passed in order.
+class SteeringEstimator {
+    public:
+        // With interpolateSensors the angular velocity at the sample timestamp of a frame is used and the lines are not
+        // delayed, the ground steering of a line is always the latest received value
+        SteeringEstimator(size_t delayFrames, bool interpolateSensors);
+
+        SteeringEstimator(const SteeringEstimator &) = delete;
+        SteeringEstimator &operator=(const SteeringEstimator &) = delete;
+
+        // Value the angular velocity is divided by before it is scaled to a steering angle
+        void setAngularDivisor(double divisor);
+
+        // Sensor side, the timestamp is the sample timestamp of the envelope in microseconds
+        void addGroundSteering(float groundSteering);
+        void addAngularVelocity(int64_t sampleTimeStamp, float angularVelocityZ);
+
+        // Frame side
+        SteeringResult estimate(bool hasTimeStamp, int64_t sampleTimeStamp);
+
+        // Min and max steering angles (+/-24% of max/min original groundSteering angles)
+        static constexpr double MAX_STEERING = 0.22107488;
+        static constexpr double MIN_STEERING = -0.22107488;
+
+        // The received angular velocities at the sample timestamps of their envelopes, enough for a few seconds of messages
+        static const size_t SENSOR_HISTORY_CAPACITY = 1024;
+
+    private:
+        bool interpolate;
+        double angularDivisor;
+
+        LatestValue<float> ground;
+        LatestValue<float> angularVelocity;
+        SensorHistory angularHistory;
+
+        // Previous timestamp
+        std::time_t previousTimeStamp;
+        // Check if the car is going backwards or forwards
+        bool isForward;
+        // Counter for how many frames have passed
+        int frameCounter;
+        // Timestamps and ground steering of the last frames while the video plays forward
+        SteeringDelay steeringDelay;
+};
+
+#endif // STEERING_ESTIMATOR_HPP
@@ -0,0 +1,93 @@
+#include "SteeringScore.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+
+SteeringScore::SteeringScore()
+    : dataPoints(0), valid(0)
+{
+}
+
+void SteeringScore::add(double groundSteering, double output)
+{
+    // Ignore rows where the original groundSteering angle is 0, a missing value is not 0 either
+    if (!(groundSteering >= 0 && groundSteering <= 0))
+    {
+        dataPoints++;
+        if (isValid(groundSteering, output))
+        {
+            valid++;
+        }
+    }
+}
+
+void SteeringScore::addColumns(const double *groundSteering, const double *output, size_t count)
+{
+    // The counts are summed as doubles, which are exact far beyond any number of lines: SSE2 has no compare of 64 bit
+    // integers, so integer counters would keep the loop from being vectorized
+    double points = 0;
+    double inBand = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        const double ground = groundSteering[i];
+        const double value = output[i];
+        const double lowerBound = ground * 0.75;
+        const double upperBound = ground * 1.25;
+
+        // For a negative output the bounds swap places, so both cases are one open interval
+        const bool positive = value >= 0;
+        const double low = positive ? lowerBound : upperBound;
+        const double high = positive ? upperBound : lowerBound;
+        const double dataPoint = (ground >= 0 && ground <= 0) ? 0.0 : 1.0;
+        points += dataPoint;
+        inBand += (value > low && value < high) ? dataPoint : 0.0;
+    }
+    dataPoints += static_cast<size_t>(points);
+    valid += static_cast<size_t>(inBand);
+}
+
+void SteeringScore::merge(const SteeringScore &other)
+{
+    dataPoints += other.dataPoints;
+    valid += other.valid;
+}
+
+size_t SteeringScore::getDataPoints() const
+{
+    return dataPoints;
+}
+
+size_t SteeringScore::getValid() const
+{
+    return valid;
+}
+
+double SteeringScore::getPercentage() const
+{
+    if (dataPoints == 0)
+    {
+        return 0;
+    }
+    return static_cast<double>(valid) / static_cast<double>(dataPoints) * 100;
+}
+
+bool SteeringScore::isValid(double groundSteering, double output)
+{
+    // Calculate the error margins
+    const double lowerBound = groundSteering * 0.75;
+    const double upperBound = groundSteering * 1.25;
+
+    // For a negative ground steering the lower bound is the larger one
+    if (output >= 0)
+    {
+        return output > lowerBound && output < upperBound;
+    }
+    return output < lowerBound && output > upperBound;
+}
+
+double SteeringScore::toCsvPrecision(double value)
+{
+    char text[32];
+    std::snprintf(text, sizeof(text), "%g", value);
+    return std::strtod(text, nullptr);
+}
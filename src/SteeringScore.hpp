@@ -0,0 +1,35 @@
+#ifndef STEERING_SCORE_HPP
+#define STEERING_SCORE_HPP
+
+#include <cstddef>
+
+// Accuracy of the steering output as compare_data.py computes it: every line whose original ground steering is not 0
+// is a data point, and it is valid when the output is within +/- 25% of the ground steering
+class SteeringScore {
+    public:
+        SteeringScore();
+
+        // Adds one line with the values as they are read back from the CSV file
+        void add(double groundSteering, double output);
+        // The same for whole columns, without a branch per line so that the compiler can vectorize the loop
+        void addColumns(const double *groundSteering, const double *output, size_t count);
+        void merge(const SteeringScore &other);
+
+        size_t getDataPoints() const;
+        size_t getValid() const;
+        // Valid lines of all data points in percent, 0 without data points
+        double getPercentage() const;
+
+        // The same check as compare_data.py, including the open bounds
+        static bool isValid(double groundSteering, double output);
+
+        // The value as it is written to the CSV file with six significant digits and parsed again, so that a score
+        // computed from the values in memory is the score of the file
+        static double toCsvPrecision(double value);
+
+    private:
+        size_t dataPoints;
+        size_t valid;
+};
+
+#endif // STEERING_SCORE_HPP
@@ -0,0 +1,107 @@
+#include "SteeringTrace.hpp"
+
+#include "cluon-complete.hpp"
+#include "opendlv-standard-message-set.hpp"
+
+#include <opencv2/core.hpp>
+
+#include "RecordingReader.hpp"
+
+SteeringTrace::SteeringTrace()
+    : recordingPath(), events(), frameCount(0)
+{
+}
+
+bool SteeringTrace::load(const std::string &recording, const std::string &frameCacheDirectory)
+{
+    recordingPath = recording;
+    events.clear();
+    frameCount = 0;
+
+    RecordingReader reader{recording, frameCacheDirectory};
+    if (!reader.open())
+    {
+        return false;
+    }
+
+    // The frames are only decoded to know which of them the evaluation processes, their pixels are not kept
+    cluon::data::Envelope envelope;
+    cv::Mat frame;
+    bool frameDecoded = false;
+    float recordedGround = 0;
+    while (reader.next(envelope, frame, frameDecoded))
+    {
+        Event event;
+        event.sampleTimeStamp = cluon::time::toMicroseconds(envelope.sampleTimeStamp());
+        if (envelope.dataType() == opendlv::proxy::GroundSteeringRequest::ID())
+        {
+            event.type = EventType::GROUND_STEERING;
+            event.value = cluon::extractMessage<opendlv::proxy::GroundSteeringRequest>(std::move(envelope)).groundSteering();
+            recordedGround = event.value;
+        }
+        else if (envelope.dataType() == opendlv::proxy::AngularVelocityReading::ID())
+        {
+            event.type = EventType::ANGULAR_VELOCITY;
+            event.value = cluon::extractMessage<opendlv::proxy::AngularVelocityReading>(std::move(envelope)).angularVelocityZ();
+        }
+        else if (frameDecoded)
+        {
+            event.type = EventType::FRAME;
+            event.value = recordedGround;
+            frameCount++;
+        }
+        else
+        {
+            continue;
+        }
+        events.push_back(event);
+    }
+    return !reader.hasFailed();
+}
+
+SteeringScore SteeringTrace::score(const SteeringSettings &settings) const
+{
+    SteeringEstimator estimator{settings.delayFrames, settings.interpolateSensors};
+    estimator.setAngularDivisor(settings.angularDivisor);
+
+    SteeringScore result;
+    for (size_t index = 0; index < events.size(); index++)
+    {
+        const Event &event = events[index];
+        switch (event.type)
+        {
+        case EventType::GROUND_STEERING:
+            estimator.addGroundSteering(event.value);
+            break;
+        case EventType::ANGULAR_VELOCITY:
+            estimator.addAngularVelocity(event.sampleTimeStamp, event.value);
+            break;
+        case EventType::FRAME:
+        {
+            const SteeringResult steering = estimator.estimate(true, event.sampleTimeStamp);
+            if (steering.hasLine)
+            {
+                // The line belongs to this frame or to one of the delayed frames just before it
+                size_t line = index;
+                while (line > 0 && (events[line].type != EventType::FRAME || events[line].sampleTimeStamp != steering.lineTimeStamp))
+                {
+                    line--;
+                }
+                result.add(SteeringScore::toCsvPrecision(events[line].value), SteeringScore::toCsvPrecision(steering.output));
+            }
+            break;
+        }
+        }
+    }
+    return result;
+}
+
+size_t SteeringTrace::getFrameCount() const
+{
+    return frameCount;
+}
+
+const std::string &SteeringTrace::getRecording() const
+{
+    return recordingPath;
+}
@@ -0,0 +1,51 @@
+#ifndef STEERING_TRACE_HPP
+#define STEERING_TRACE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "SteeringEstimator.hpp"
+#include "SteeringScore.hpp"
+
+// The sensor values of a recording and the sample timestamps of its frames in their order, which is everything the
+// steering output depends on. The recording is decoded once when the trace is loaded to find the frames that the
+// evaluation processes; their pixels are not kept. Afterwards the output lines of any steering settings are scored by
+// replaying the trace without touching a single pixel.
+class SteeringTrace {
+    public:
+        SteeringTrace();
+
+        // False if the recording cannot be decoded, the frames are taken from the frame cache in the directory if
+        // one is given
+        bool load(const std::string &recording, const std::string &frameCacheDirectory = "");
+
+        // Score of the output lines as the evaluation computes it for the same recording. The output of a line is
+        // compared with the ground steering that was recorded last before the frame at the timestamp of the line, which
+        // does not depend on the settings.
+        SteeringScore score(const SteeringSettings &settings) const;
+
+        size_t getFrameCount() const;
+        const std::string &getRecording() const;
+
+    private:
+        enum class EventType : uint8_t {
+            GROUND_STEERING,
+            ANGULAR_VELOCITY,
+            FRAME
+        };
+
+        // The value of a frame is the ground steering that was recorded last before it, 0 before the first one
+        struct Event {
+            EventType type;
+            int64_t sampleTimeStamp;
+            float value;
+        };
+
+        std::string recordingPath;
+        std::vector<Event> events;
+        size_t frameCount;
+};
+
+#endif // STEERING_TRACE_HPP
@@ -0,0 +1,91 @@
+#include "catch.hpp"
+
+#include <opencv2/core.hpp>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+#include "ConeDetector.hpp"
+#include "SteeringEstimator.hpp"
+#include "WorkerPool.hpp"
+
+namespace {
+// Calls of the global operator new on any thread of the runner. The image buffers of OpenCV are not allocated with
+// operator new, they are checked by the workspace itself.
+std::atomic<size_t> allocations{0};
+}
+
+void *operator new(size_t size)
+{
+    allocations++;
+    void *memory = std::malloc((size != 0) ? size : 1);
+    if (memory == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+    return memory;
+}
+
+void operator delete(void *memory) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete(void *memory, size_t) noexcept
+{
+    std::free(memory);
+}
+
+TEST_CASE("Detecting the cones and steering do not allocate once the frames are warm") {
+    const uint32_t WIDTH = 640;
+    const uint32_t HEIGHT = 480;
+    ConeDetector coneDetector{ConeColorStage::Mode::FUSED, ImageDenoiser::Mode::FUSED, BlobDetector::Mode::RUNS};
+    coneDetector.allocate(WIDTH, HEIGHT, 2);
+    coneDetector.setColorRanges(ConeColorSettings());
+    coneDetector.setThresholds(ConeColorSettings());
+    FrameWorkspace &workspace = coneDetector.getWorkspace();
+    SteeringEstimator steeringEstimator{2, false};
+    WorkerPool workerPool{1};
+    std::vector<cv::Rect> boxesBlue;
+    std::vector<cv::Rect> boxesYellow;
+
+    // Two cones of each color in the region of interest, they move a little from frame to frame
+    cv::Mat image(static_cast<int>(HEIGHT), static_cast<int>(WIDTH), CV_8UC3);
+    auto processFrame = [&](int frame) {
+        image.setTo(cv::Scalar::all(0));
+        const int shift = frame % 8;
+        image(cv::Rect(100 + shift, 300, 20, 40)).setTo(cv::Scalar(80, 17, 17));
+        image(cv::Rect(200 + shift, 350, 20, 40)).setTo(cv::Scalar(80, 17, 17));
+        image(cv::Rect(420 - shift, 300, 20, 40)).setTo(cv::Scalar(109, 180, 180));
+        image(cv::Rect(520 - shift, 350, 20, 40)).setTo(cv::Scalar(109, 180, 180));
+
+        const cv::Mat imageROI = image(coneDetector.getRoi());
+        coneDetector.classifyAndDenoise(imageROI, workspace.maskBlue, workspace.maskYellow, workspace.processedBlue,
+                                        workspace.processedYellow, workerPool);
+        coneDetector.findCones(workspace.processedBlue, workspace.processedYellow, workerPool, boxesBlue, boxesYellow);
+        steeringEstimator.addAngularVelocity(frame * 50000, 10.0f * static_cast<float>(shift));
+        steeringEstimator.addGroundSteering(0.01f * static_cast<float>(shift));
+        steeringEstimator.estimate(true, frame * 50000);
+    };
+
+    for (int frame = 0; frame < 2; frame++)
+    {
+        processFrame(frame);
+    }
+    workspace.markWarm();
+
+    const size_t warmAllocations = allocations.load();
+    for (int frame = 2; frame < 50; frame++)
+    {
+        processFrame(frame);
+    }
+    const size_t frameAllocations = allocations.load() - warmAllocations;
+
+    REQUIRE(boxesBlue.size() == 2);
+    REQUIRE(boxesYellow.size() == 2);
+    REQUIRE(frameAllocations == 0);
+    REQUIRE(workspace.countReallocations() == 0);
+}
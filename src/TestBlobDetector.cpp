@@ -0,0 +1,109 @@
+#include "catch.hpp"
+
+#include <opencv2/core.hpp>
+#include <opencv2/imgproc.hpp>
+
+#include <algorithm>
+#include <tuple>
+#include <vector>
+
+#include "BlobDetector.hpp"
+
+namespace {
+// The boxes of cv::findContours with cv::RETR_EXTERNAL, sorted like the boxes of the detectors
+std::vector<cv::Rect> referenceBoxes(const cv::Mat &mask)
+{
+    std::vector<std::vector<cv::Point>> contours;
+    cv::findContours(mask.clone(), contours, cv::RETR_EXTERNAL, cv::CHAIN_APPROX_SIMPLE);
+    std::vector<cv::Rect> boxes;
+    for (const std::vector<cv::Point> &contour : contours)
+    {
+        boxes.push_back(cv::boundingRect(contour));
+    }
+    return boxes;
+}
+
+void sortBoxes(std::vector<cv::Rect> &boxes)
+{
+    std::sort(boxes.begin(), boxes.end(), [](const cv::Rect &a, const cv::Rect &b) {
+        return std::tie(a.y, a.x, a.height, a.width) < std::tie(b.y, b.x, b.height, b.width);
+    });
+}
+
+void requireSameBoxes(const cv::Mat &mask)
+{
+    std::vector<cv::Rect> expected = referenceBoxes(mask);
+    sortBoxes(expected);
+    for (BlobDetector::Mode mode : {BlobDetector::Mode::RUNS, BlobDetector::Mode::LABELS, BlobDetector::Mode::BITMASK})
+    {
+        INFO("mode " << static_cast<int>(mode) << ", " << mask.cols << "x" << mask.rows);
+        BlobDetector detector{mode};
+        std::vector<cv::Rect> boxes;
+        REQUIRE(detector.detect(mask, boxes) == expected.size());
+        sortBoxes(boxes);
+        REQUIRE(boxes == expected);
+    }
+}
+}
+
+TEST_CASE("Blobs inside the holes of other blobs are dropped like findContours does") {
+    cv::Mat mask(60, 80, CV_8U, cv::Scalar::all(0));
+    // A ring with a blob and another ring in its hole, and a pixel inside of the inner ring
+    cv::rectangle(mask, cv::Point(5, 5), cv::Point(50, 50), cv::Scalar::all(255), 2);
+    cv::rectangle(mask, cv::Point(15, 15), cv::Point(25, 25), cv::Scalar::all(255), cv::FILLED);
+    cv::rectangle(mask, cv::Point(30, 30), cv::Point(45, 45), cv::Scalar::all(255), 1);
+    mask.at<uint8_t>(37, 37) = 255;
+    // A blob at the border with a hole that holds a single pixel
+    cv::rectangle(mask, cv::Point(55, 0), cv::Point(79, 59), cv::Scalar::all(255), cv::FILLED);
+    mask(cv::Rect(60, 20, 15, 20)).setTo(cv::Scalar::all(0));
+    mask.at<uint8_t>(30, 67) = 255;
+    // Pixels that only touch diagonally belong to the same blob, and a pixel in the corner
+    mask.at<uint8_t>(0, 0) = 255;
+    mask.at<uint8_t>(1, 1) = 255;
+    mask.at<uint8_t>(59, 79) = 255;
+
+    requireSameBoxes(mask);
+    REQUIRE(referenceBoxes(mask).size() == 3);
+}
+
+TEST_CASE("Empty and full masks") {
+    requireSameBoxes(cv::Mat(10, 10, CV_8U, cv::Scalar::all(0)));
+    requireSameBoxes(cv::Mat(10, 10, CV_8U, cv::Scalar::all(255)));
+    requireSameBoxes(cv::Mat(1, 1, CV_8U, cv::Scalar::all(255)));
+}
+
+TEST_CASE("The detectors find the boxes of findContours on random masks") {
+    cv::RNG rng(18);
+    const cv::Mat closing = cv::getStructuringElement(cv::MORPH_RECT, cv::Size(3, 3));
+    for (int i = 0; i < 300; i++)
+    {
+        // Sparse to dense noise, every third mask closed so it has larger blobs with holes
+        const cv::Size size(rng.uniform(1, 150), rng.uniform(1, 90));
+        const int percent = std::vector<int>{5, 30, 50, 70}[static_cast<size_t>(i % 4)];
+        cv::Mat mask(size, CV_8U);
+        for (int y = 0; y < mask.rows; y++)
+        {
+            for (int x = 0; x < mask.cols; x++)
+            {
+                mask.at<uint8_t>(y, x) = (rng.uniform(0, 100) < percent) ? 255 : 0;
+            }
+        }
+        if (i % 3 == 0)
+        {
+            cv::morphologyEx(mask, mask, cv::MORPH_CLOSE, closing);
+        }
+        requireSameBoxes(mask);
+    }
+
+    // The region of interest of a frame, with masks that are a view into a larger mask
+    cv::Mat frame(480, 640, CV_8U);
+    for (int y = 0; y < frame.rows; y++)
+    {
+        for (int x = 0; x < frame.cols; x++)
+        {
+            frame.at<uint8_t>(y, x) = (rng.uniform(0, 100) < 20) ? 255 : 0;
+        }
+    }
+    cv::morphologyEx(frame, frame, cv::MORPH_CLOSE, closing);
+    requireSameBoxes(frame(cv::Rect(3, 230, 631, 250)));
+}
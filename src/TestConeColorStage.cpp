@@ -0,0 +1,162 @@
+#include "catch.hpp"
+
+#include <opencv2/core.hpp>
+#include <opencv2/imgproc.hpp>
+
+#include <cstdint>
+#include <vector>
+
+#include "ConeColorKernel.hpp"
+#include "ConeColorStage.hpp"
+
+namespace {
+struct ColorBounds {
+    cv::Scalar blueLow;
+    cv::Scalar blueHigh;
+    cv::Scalar yellowLow;
+    cv::Scalar yellowHigh;
+};
+
+// The tuned bounds, bounds around the hue wrap-around of red, bounds at 0 and 255, and bounds outside of the 8-bit range
+const std::vector<ColorBounds> BOUNDS{
+    {{109, 68, 42}, {135, 250, 120}, {11, 20, 128}, {54, 198, 232}},
+    {{170, 50, 50}, {180, 255, 255}, {0, 50, 50}, {10, 255, 255}},
+    {{179, 255, 255}, {179, 255, 255}, {0, 0, 0}, {0, 255, 255}},
+    {{0, 0, 0}, {0, 0, 0}, {255, 255, 255}, {255, 255, 255}},
+    {{0, 0, 0}, {180, 255, 255}, {0, 0, 0}, {255, 255, 255}},
+    {{20, 10, 10}, {10, 255, 255}, {-5, -5, -5}, {300, 300, 300}},
+};
+
+// Every 24-bit BGR color once, 4096 x 4096 pixels
+cv::Mat allColors(int channels)
+{
+    cv::Mat image(4096, 4096, CV_8UC(channels));
+    for (int y = 0; y < image.rows; y++)
+    {
+        uint8_t *pixel = image.ptr<uint8_t>(y);
+        for (int x = 0; x < image.cols; x++, pixel += channels)
+        {
+            const uint32_t color = static_cast<uint32_t>(y) * 4096 + static_cast<uint32_t>(x);
+            pixel[0] = static_cast<uint8_t>(color >> 16);
+            pixel[1] = static_cast<uint8_t>(color >> 8);
+            pixel[2] = static_cast<uint8_t>(color);
+            if (channels == 4)
+            {
+                pixel[3] = static_cast<uint8_t>(x);
+            }
+        }
+    }
+    return image;
+}
+
+void referenceMasks(const cv::Mat &image, const ColorBounds &bounds, cv::Mat &maskBlue, cv::Mat &maskYellow)
+{
+    cv::Mat hsv;
+    cv::cvtColor(image, hsv, cv::COLOR_BGR2HSV);
+    cv::inRange(hsv, bounds.blueLow, bounds.blueHigh, maskBlue);
+    cv::inRange(hsv, bounds.yellowLow, bounds.yellowHigh, maskYellow);
+}
+
+HsvRange toRange(const cv::Scalar &low, const cv::Scalar &high)
+{
+    HsvRange range;
+    for (int c = 0; c < 3; c++)
+    {
+        range.low[c] = cvRound(low[c]);
+        range.high[c] = cvRound(high[c]);
+    }
+    return range;
+}
+
+size_t differentPixels(const cv::Mat &a, const cv::Mat &b)
+{
+    cv::Mat difference;
+    cv::compare(a, b, difference, cv::CMP_NE);
+    return static_cast<size_t>(cv::countNonZero(difference));
+}
+}
+
+TEST_CASE("The fused and the lookup table stages classify every color like cvtColor and inRange") {
+    for (int channels : {3, 4})
+    {
+        const cv::Mat image = allColors(channels);
+        for (size_t i = 0; i < BOUNDS.size(); i++)
+        {
+            INFO("channels " << channels << ", bounds " << i);
+            cv::Mat expectedBlue, expectedYellow;
+            referenceMasks(image, BOUNDS[i], expectedBlue, expectedYellow);
+
+            for (ConeColorStage::Mode mode : {ConeColorStage::Mode::FUSED, ConeColorStage::Mode::LUT})
+            {
+                ConeColorStage stage{mode};
+                stage.setBlueRange(BOUNDS[i].blueLow, BOUNDS[i].blueHigh);
+                stage.setYellowRange(BOUNDS[i].yellowLow, BOUNDS[i].yellowHigh);
+                cv::Mat maskBlue, maskYellow;
+                stage.process(image, maskBlue, maskYellow);
+                REQUIRE(differentPixels(maskBlue, expectedBlue) == 0);
+                REQUIRE(differentPixels(maskYellow, expectedYellow) == 0);
+            }
+        }
+    }
+}
+
+TEST_CASE("Every instruction set of the fused kernel gives the masks of cvtColor and inRange") {
+    const cv::Mat image = allColors(4);
+    const ColorBounds &bounds = BOUNDS.front();
+    cv::Mat expectedBlue, expectedYellow;
+    referenceMasks(image, bounds, expectedBlue, expectedYellow);
+
+    for (ConeColorKernel::Isa isa : {ConeColorKernel::Isa::SCALAR, ConeColorKernel::Isa::SSE41, ConeColorKernel::Isa::AVX2})
+    {
+        if (!ConeColorKernel::isSupported(isa))
+        {
+            continue;
+        }
+        INFO(ConeColorKernel::name(isa));
+
+        // Rows whose width is not a multiple of the vector width, so the tail of every row is classified too
+        const cv::Mat pixels = image.colRange(0, 4093);
+        cv::Mat maskBlue(pixels.size(), CV_8U);
+        cv::Mat maskYellow(pixels.size(), CV_8U);
+        for (int y = 0; y < pixels.rows; y++)
+        {
+            ConeColorKernel::classify(pixels.ptr<uint8_t>(y), pixels.channels(), static_cast<size_t>(pixels.cols), toRange(bounds.blueLow, bounds.blueHigh),
+                                      toRange(bounds.yellowLow, bounds.yellowHigh), maskBlue.ptr<uint8_t>(y), maskYellow.ptr<uint8_t>(y), isa);
+        }
+        REQUIRE(differentPixels(maskBlue, expectedBlue.colRange(0, 4093)) == 0);
+        REQUIRE(differentPixels(maskYellow, expectedYellow.colRange(0, 4093)) == 0);
+    }
+}
+
+TEST_CASE("Classifying strips of rows gives the masks of a single pass") {
+    // A region of interest inside a larger frame, so its rows are not continuous
+    cv::RNG rng(18);
+    cv::Mat frame(480, 640, CV_8UC4);
+    rng.fill(frame, cv::RNG::UNIFORM, 0, 256);
+    const cv::Mat imageROI = frame(cv::Rect(3, 230, 631, 250));
+    const ColorBounds &bounds = BOUNDS.front();
+
+    for (ConeColorStage::Mode mode : {ConeColorStage::Mode::OPENCV, ConeColorStage::Mode::FUSED, ConeColorStage::Mode::LUT})
+    {
+        ConeColorStage stage{mode};
+        stage.setBlueRange(bounds.blueLow, bounds.blueHigh);
+        stage.setYellowRange(bounds.yellowLow, bounds.yellowHigh);
+        cv::Mat expectedBlue, expectedYellow;
+        stage.process(imageROI, expectedBlue, expectedYellow);
+        expectedBlue = expectedBlue.clone();
+        expectedYellow = expectedYellow.clone();
+
+        for (int strips : {2, 3, 7, 16})
+        {
+            INFO("mode " << static_cast<int>(mode) << ", " << strips << " strips");
+            cv::Mat maskBlue, maskYellow;
+            stage.prepare(imageROI, maskBlue, maskYellow);
+            for (int strip = 0; strip < strips; strip++)
+            {
+                stage.processRows(imageROI, maskBlue, maskYellow, imageROI.rows * strip / strips, imageROI.rows * (strip + 1) / strips);
+            }
+            REQUIRE(differentPixels(maskBlue, expectedBlue) == 0);
+            REQUIRE(differentPixels(maskYellow, expectedYellow) == 0);
+        }
+    }
+}
@@ -0,0 +1,158 @@
+#include "catch.hpp"
+
+#include <opencv2/core.hpp>
+#include <opencv2/imgproc.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+#include "ImageDenoiser.hpp"
+
+namespace {
+// The steps of the original denoiser, one OpenCV function each
+cv::Mat referenceDenoise(const cv::Mat &originalImage, const cv::Mat &colorMask, int kernelSize, const cv::Rect &ignoreRegion, int thresholdValue,
+                         int maxValue)
+{
+    cv::Mat ignoreMask(colorMask.size(), CV_8U, cv::Scalar::all(1));
+    ignoreMask(ignoreRegion & cv::Rect(0, 0, colorMask.cols, colorMask.rows)).setTo(cv::Scalar::all(0));
+
+    cv::Mat cleaned;
+    cv::GaussianBlur(colorMask, cleaned, cv::Size(kernelSize, kernelSize), 0);
+    cv::morphologyEx(cleaned, cleaned, cv::MORPH_CLOSE, cv::getStructuringElement(cv::MORPH_RECT, cv::Size(kernelSize, kernelSize)));
+    cv::bitwise_and(cleaned, ignoreMask, cleaned);
+
+    cv::Mat maskedImage(originalImage.size(), originalImage.type(), cv::Scalar::all(0));
+    cv::bitwise_and(originalImage, originalImage, maskedImage, cleaned);
+    cv::Mat processed;
+    cv::cvtColor(maskedImage, processed, (originalImage.channels() == 4) ? cv::COLOR_BGRA2GRAY : cv::COLOR_BGR2GRAY);
+    cv::threshold(processed, processed, thresholdValue, maxValue, cv::THRESH_BINARY);
+    return processed;
+}
+
+// Filled rectangles of 255 that may cross the border, with salt and pepper noise on top like the masks of inRange
+cv::Mat randomMask(cv::RNG &rng, const cv::Size &size)
+{
+    cv::Mat mask(size, CV_8U, cv::Scalar::all(0));
+    const int rectangles = std::max(1, size.area() / 800);
+    for (int i = 0; i < rectangles; i++)
+    {
+        const cv::Point corner(rng.uniform(-5, size.width), rng.uniform(-5, size.height));
+        cv::rectangle(mask, corner, corner + cv::Point(rng.uniform(1, 30), rng.uniform(1, 30)), cv::Scalar::all(255), cv::FILLED);
+    }
+    for (int y = 0; y < mask.rows; y++)
+    {
+        for (int x = 0; x < mask.cols; x++)
+        {
+            if (rng.uniform(0, 20) == 0)
+            {
+                mask.at<uint8_t>(y, x) = static_cast<uint8_t>(255 - mask.at<uint8_t>(y, x));
+            }
+        }
+    }
+    return mask;
+}
+
+size_t differentPixels(const cv::Mat &a, const cv::Mat &b)
+{
+    cv::Mat difference;
+    cv::compare(a, b, difference, cv::CMP_NE);
+    return static_cast<size_t>(cv::countNonZero(difference));
+}
+}
+
+TEST_CASE("The fused denoiser gives the result of GaussianBlur, morphologyEx and threshold") {
+    cv::RNG rng(18);
+
+    // The region of interest of a frame, odd sizes and images as small as the kernel, so every row and column is
+    // near an edge of the image
+    const std::vector<cv::Size> sizes{{640, 250}, {641, 13}, {37, 23}, {8, 7}, {7, 7}, {5, 5}, {3, 3}};
+    for (const cv::Size &size : sizes)
+    {
+        for (int kernelSize : {3, 5, 7})
+        {
+            if (size.width < kernelSize || size.height < kernelSize)
+            {
+                continue;
+            }
+            for (int channels : {3, 4})
+            {
+                // The pixels are a view into a larger frame, so their rows are not continuous
+                cv::Mat frame(size.height + 2, size.width + 3, CV_8UC(channels));
+                rng.fill(frame, cv::RNG::UNIFORM, 0, 256);
+                const cv::Mat originalImage = frame(cv::Rect(cv::Point(2, 1), size));
+                const cv::Mat colorMask = randomMask(rng, size);
+
+                // The car region, a region that is only partly inside of the image, and no region at all
+                const std::vector<cv::Rect> ignoreRegions{ImageDenoiser::carRegion(size), cv::Rect(size.width - 3, size.height - 2, 10, 10), cv::Rect()};
+                for (const cv::Rect &ignoreRegion : ignoreRegions)
+                {
+                    for (int thresholdValue : {30, 0, 254})
+                    {
+                        INFO(size.width << "x" << size.height << ", kernel " << kernelSize << ", " << channels << " channels, threshold " << thresholdValue);
+                        const cv::Mat expected = referenceDenoise(originalImage, colorMask, kernelSize, ignoreRegion, thresholdValue, 255);
+
+                        ImageDenoiser denoiser{ImageDenoiser::Mode::FUSED};
+                        denoiser.configure(size, originalImage.type(), kernelSize, ignoreRegion);
+                        REQUIRE(denoiser.getMode() == ImageDenoiser::Mode::FUSED);
+                        cv::Mat processed;
+                        denoiser.denoiseImage(originalImage, colorMask, processed, thresholdValue, 255);
+                        REQUIRE(differentPixels(processed, expected) == 0);
+                    }
+                }
+            }
+        }
+    }
+}
+
+TEST_CASE("Mask values other than 0 and 255 are denoised like OpenCV does") {
+    // After the blur and the closing only odd values pass the ignore mask of 1s, the random values cover both
+    cv::RNG rng(18);
+    const cv::Size size(97, 61);
+    cv::Mat originalImage(size, CV_8UC4);
+    rng.fill(originalImage, cv::RNG::UNIFORM, 0, 256);
+    cv::Mat colorMask(size, CV_8U);
+    rng.fill(colorMask, cv::RNG::UNIFORM, 0, 256);
+
+    for (int kernelSize : {3, 5, 7})
+    {
+        INFO("kernel " << kernelSize);
+        const cv::Mat expected = referenceDenoise(originalImage, colorMask, kernelSize, ImageDenoiser::carRegion(size), 30, 255);
+        ImageDenoiser denoiser{ImageDenoiser::Mode::FUSED};
+        denoiser.configure(size, originalImage.type(), kernelSize, ImageDenoiser::carRegion(size));
+        cv::Mat processed;
+        denoiser.denoiseImage(originalImage, colorMask, processed, 30, 255);
+        REQUIRE(differentPixels(processed, expected) == 0);
+    }
+}
+
+TEST_CASE("Denoising strips of rows gives the result of a single pass") {
+    cv::RNG rng(18);
+    const cv::Size size(640, 250);
+    cv::Mat originalImage(size, CV_8UC4);
+    rng.fill(originalImage, cv::RNG::UNIFORM, 0, 256);
+    const cv::Mat colorMask = randomMask(rng, size);
+
+    for (int kernelSize : {3, 5, 7})
+    {
+        ImageDenoiser single{ImageDenoiser::Mode::FUSED};
+        single.configure(size, originalImage.type(), kernelSize, ImageDenoiser::carRegion(size));
+        cv::Mat expected;
+        single.denoiseImage(originalImage, colorMask, expected, 30, 255);
+
+        // Strips of a single row and strips that are only a few rows high need the rows of the neighbouring strips
+        for (size_t strips : {2, 3, 7, 16, 125, 250})
+        {
+            INFO("kernel " << kernelSize << ", " << strips << " strips");
+            ImageDenoiser denoiser{ImageDenoiser::Mode::FUSED};
+            denoiser.configure(size, originalImage.type(), kernelSize, ImageDenoiser::carRegion(size), strips);
+            REQUIRE(denoiser.getStripCount() == strips);
+            cv::Mat processed(size, CV_8U, cv::Scalar::all(128));
+            for (size_t strip = strips; strip-- > 0;)
+            {
+                denoiser.denoiseStrip(originalImage, colorMask, processed, 30, 255, strip);
+            }
+            REQUIRE(differentPixels(processed, expected) == 0);
+        }
+    }
+}
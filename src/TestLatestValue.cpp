@@ -0,0 +1,62 @@
+#define CATCH_CONFIG_MAIN
+#include "catch.hpp"
+
+#include <cstdint>
+#include <thread>
+
+#include "LatestValue.hpp"
+
+namespace {
+// The three fields are written one after the other, a torn read mixes the fields of two readings
+struct Reading {
+    uint32_t sequence;
+    uint32_t inverted;
+    uint64_t doubled;
+};
+}
+
+TEST_CASE("The cell holds a default value until the first store and then the latest one") {
+    LatestValue<int> latest;
+    REQUIRE(latest.load() == 0);
+
+    latest.store(1);
+    latest.store(2);
+    REQUIRE(latest.load() == 2);
+    // Without a new store the reader keeps its value
+    REQUIRE(latest.load() == 2);
+
+    latest.store(3);
+    REQUIRE(latest.load() == 3);
+}
+
+TEST_CASE("Readings are never torn or older than the previous one while a thread stores") {
+    // One thread stores readings as fast as it can, like the OD4 receiver, while this thread reads them
+    LatestValue<Reading> latest;
+    const uint32_t STORES = 5000000;
+    std::thread writer([&latest, STORES]() {
+        for (uint32_t i = 1; i <= STORES; i++)
+        {
+            latest.store(Reading{i, ~i, 2 * static_cast<uint64_t>(i)});
+        }
+    });
+
+    uint64_t tornReads = 0;
+    uint32_t previous = 0;
+    for (;;)
+    {
+        // Until the first store the cell holds a zero reading
+        const Reading &reading = latest.load();
+        if (reading.sequence != 0 && (reading.inverted != ~reading.sequence || reading.doubled != 2 * static_cast<uint64_t>(reading.sequence) || reading.sequence < previous))
+        {
+            tornReads++;
+        }
+        previous = reading.sequence;
+        if (reading.sequence == STORES)
+        {
+            break;
+        }
+    }
+    writer.join();
+
+    REQUIRE(tornReads == 0);
+}
@@ -0,0 +1,239 @@
+/*
+ * Copyright (C) 2024 Christian Berger, Ionel Pop, Adrian Hassa,
+ *                        Teodora Portase, Vasilena Karaivanova
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Searches the steering settings with the best accuracy over a set of recordings. The recordings are decoded once into
+// steering traces, after which every configuration is scored by replaying the traces on the threads of a worker pool.
+
+// Include the single-file, header-only middleware libcluon for the command line parameters
+#include "cluon-complete.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "SteeringTrace.hpp"
+#include "WorkerPool.hpp"
+
+// A configuration and the pooled score of all recordings
+struct Candidate {
+    SteeringSettings settings{};
+    SteeringScore score{};
+};
+
+// Better when more of the data points are valid, the earlier candidate wins a tie
+static bool isBetter(const Candidate &candidate, const Candidate &best)
+{
+    return static_cast<double>(candidate.score.getValid()) * static_cast<double>(best.score.getDataPoints()) >
+           static_cast<double>(best.score.getValid()) * static_cast<double>(candidate.score.getDataPoints());
+}
+
+static void printSettings(std::ostream &out, const SteeringSettings &settings)
+{
+    out << "divisor " << settings.angularDivisor << ", delay " << settings.delayFrames << " frames, sensors "
+        << (settings.interpolateSensors ? "interpolate" : "latest");
+}
+
+// Scores the candidates, one task per candidate that scores it on all traces
+static void scoreCandidates(std::vector<Candidate> &candidates, const std::vector<SteeringTrace> &traces, WorkerPool &pool)
+{
+    pool.run(candidates.size(), [&](size_t index) {
+        Candidate &candidate = candidates[index];
+        candidate.score = SteeringScore();
+        for (const SteeringTrace &trace : traces)
+        {
+            candidate.score.merge(trace.score(candidate.settings));
+        }
+    });
+}
+
+int32_t main(int32_t argc, char **argv)
+{
+    auto commandlineArguments = cluon::getCommandlineArguments(argc, argv);
+    if (0 == commandlineArguments.count("rec"))
+    {
+        std::cerr << argv[0] << " searches the steering settings with the best accuracy on recordings." << std::endl;
+        std::cerr << "Usage:   " << argv[0] << " --rec=<file>[,<file>...] [--search=<grid|descent>] [--threads=<n>] [--max-delay=<n>] [--frame-cache=<directory>]" << std::endl;
+        std::cerr << "         --rec:    recordings to tune on, each is decoded once and kept in memory as a trace of its sensor values and frame timestamps" << std::endl;
+        std::cerr << "         --search: 'grid' scores every divisor from 40 to 140 in steps of 0.5 with every delay and sensor mode (default)," << std::endl;
+        std::cerr << "                   'descent' changes one setting at a time from the current settings while that improves the score" << std::endl;
+        std::cerr << "         --threads: threads that score the configurations (default: all cores)" << std::endl;
+        std::cerr << "         --max-delay: largest --delay-frames that is tried (default: 4)" << std::endl;
+        std::cerr << "         --frame-cache: directory with the decoded frames of the recordings, the frames are decoded into it when they are not there yet" << std::endl;
+        std::cerr << "The HSV bounds and thresholds are not searched, the cones they find do not change the steering output." << std::endl;
+        std::cerr << "Example: " << argv[0] << " --rec=recordings/RECORDING1.rec --search=descent" << std::endl;
+        return 1;
+    }
+
+    const std::string SEARCH{(commandlineArguments.count("search") != 0) ? commandlineArguments["search"] : "grid"};
+    if (SEARCH != "grid" && SEARCH != "descent")
+    {
+        std::cerr << argv[0] << ": Unknown search '" << SEARCH << "'." << std::endl;
+        return 1;
+    }
+    const int THREADS{(commandlineArguments.count("threads") != 0) ? std::stoi(commandlineArguments["threads"])
+                                                                    : static_cast<int>(std::max(1u, std::thread::hardware_concurrency()))};
+    const int MAX_DELAY{(commandlineArguments.count("max-delay") != 0) ? std::stoi(commandlineArguments["max-delay"]) : 4};
+    if (THREADS < 1 || MAX_DELAY < 0)
+    {
+        std::cerr << argv[0] << ": --threads requires at least 1 thread and --max-delay cannot be negative." << std::endl;
+        return 1;
+    }
+
+    const std::string FRAME_CACHE{commandlineArguments["frame-cache"]};
+
+    std::vector<std::string> recordings;
+    std::stringstream recordingList{commandlineArguments["rec"]};
+    std::string recordingPath;
+    while (std::getline(recordingList, recordingPath, ','))
+    {
+        if (!recordingPath.empty())
+        {
+            recordings.push_back(recordingPath);
+        }
+    }
+
+    // The workers take the next task as soon as they are done, so slow recordings and configurations even out
+    WorkerPool pool{static_cast<size_t>(THREADS) - 1};
+
+    // Decode every recording once
+    auto loadStart = std::chrono::steady_clock::now();
+    std::vector<SteeringTrace> traces(recordings.size());
+    std::vector<char> loaded(recordings.size(), 0);
+    pool.run(recordings.size(), [&](size_t index) {
+        loaded[index] = traces[index].load(recordings[index], FRAME_CACHE) ? 1 : 0;
+    });
+    for (size_t i = 0; i < recordings.size(); i++)
+    {
+        if (loaded[i] == 0)
+        {
+            std::cerr << argv[0] << ": Cannot decode the h264 frames of '" << recordings[i] << "'." << std::endl;
+            return 1;
+        }
+        std::cout << recordings[i] << ": " << traces[i].getFrameCount() << " frames" << std::endl;
+    }
+    std::cout << "Loaded " << traces.size() << " recordings in "
+              << std::chrono::duration<double>(std::chrono::steady_clock::now() - loadStart).count() << " s" << std::endl;
+
+    // The current settings of the microservice, the search starts from them and reports against them
+    std::vector<Candidate> current(1);
+    scoreCandidates(current, traces, pool);
+    Candidate best = current[0];
+
+    auto searchStart = std::chrono::steady_clock::now();
+    size_t evaluated = 0;
+    if (SEARCH == "grid")
+    {
+        std::vector<Candidate> candidates;
+        for (int interpolate = 0; interpolate < 2; interpolate++)
+        {
+            for (int delay = 0; delay <= MAX_DELAY; delay++)
+            {
+                for (int step = 0; step <= 200; step++)
+                {
+                    Candidate candidate;
+                    candidate.settings.angularDivisor = 40 + step * 0.5;
+                    candidate.settings.delayFrames = static_cast<size_t>(delay);
+                    candidate.settings.interpolateSensors = interpolate != 0;
+                    candidates.push_back(candidate);
+                }
+            }
+        }
+        scoreCandidates(candidates, traces, pool);
+        evaluated = candidates.size();
+        for (const Candidate &candidate : candidates)
+        {
+            if (isBetter(candidate, best))
+            {
+                best = candidate;
+            }
+        }
+    }
+    else
+    {
+        // Coordinate descent: all neighbours of the best settings are scored at once, the divisor step is halved
+        // whenever none of them is better
+        double divisorStep = 8;
+        while (divisorStep >= 0.125)
+        {
+            std::vector<Candidate> candidates;
+            for (const double divisor : {best.settings.angularDivisor - divisorStep, best.settings.angularDivisor + divisorStep})
+            {
+                if (divisor > 0)
+                {
+                    Candidate candidate = best;
+                    candidate.settings.angularDivisor = divisor;
+                    candidates.push_back(candidate);
+                }
+            }
+            if (best.settings.delayFrames > 0)
+            {
+                Candidate candidate = best;
+                candidate.settings.delayFrames--;
+                candidates.push_back(candidate);
+            }
+            if (best.settings.delayFrames < static_cast<size_t>(MAX_DELAY))
+            {
+                Candidate candidate = best;
+                candidate.settings.delayFrames++;
+                candidates.push_back(candidate);
+            }
+            Candidate toggled = best;
+            toggled.settings.interpolateSensors = !best.settings.interpolateSensors;
+            candidates.push_back(toggled);
+
+            scoreCandidates(candidates, traces, pool);
+            evaluated += candidates.size();
+            bool improved = false;
+            for (const Candidate &candidate : candidates)
+            {
+                if (isBetter(candidate, best))
+                {
+                    best = candidate;
+                    improved = true;
+                }
+            }
+            if (!improved)
+            {
+                divisorStep /= 2;
+            }
+        }
+    }
+    const double searchSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - searchStart).count();
+
+    std::cout << "Scored " << evaluated << " configurations in " << searchSeconds << " s on " << THREADS << " threads" << std::endl;
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "Current: ";
+    printSettings(std::cout, current[0].settings);
+    std::cout << ": " << current[0].score.getPercentage() << " %" << std::endl;
+    std::cout << "Best:    ";
+    printSettings(std::cout, best.settings);
+    std::cout << ": " << best.score.getPercentage() << " % (" << best.score.getValid() << "/" << best.score.getDataPoints() << ")" << std::endl;
+    for (const SteeringTrace &trace : traces)
+    {
+        const SteeringScore score = trace.score(best.settings);
+        std::cout << "  " << trace.getRecording() << ": " << score.getPercentage() << " % (" << score.getValid() << "/" << score.getDataPoints() << ")" << std::endl;
+    }
+    std::cout << "Run with --delay-frames=" << best.settings.delayFrames << " --sensors=" << (best.settings.interpolateSensors ? "interpolate" : "latest")
+              << " --angular-divisor=" << best.settings.angularDivisor << std::endl;
+    return 0;
+}
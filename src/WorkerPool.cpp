@@ -0,0 +1,93 @@
+#include "WorkerPool.hpp"
+
+WorkerPool::WorkerPool(size_t workers)
+    : threads(), poolMutex(), workAvailable(), workDone(), currentTask(nullptr), currentInvoker(nullptr), taskCount(0),
+      nextTask(0), finishedTasks(0), generation(0), stopping(false)
+{
+    for (size_t i = 0; i < workers; i++)
+    {
+        threads.emplace_back(&WorkerPool::work, this);
+    }
+}
+
+WorkerPool::~WorkerPool()
+{
+    {
+        std::lock_guard<std::mutex> lck(poolMutex);
+        stopping = true;
+    }
+    workAvailable.notify_all();
+    for (std::thread &thread : threads)
+    {
+        thread.join();
+    }
+}
+
+void WorkerPool::runBatch(size_t count, const void *task, Invoker invoker)
+{
+    if (threads.empty() || count < 2)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            invoker(task, i);
+        }
+        return;
+    }
+
+    std::unique_lock<std::mutex> lck(poolMutex);
+    currentTask = task;
+    currentInvoker = invoker;
+    taskCount = count;
+    nextTask = 0;
+    finishedTasks = 0;
+    generation++;
+    workAvailable.notify_all();
+
+    // The calling thread works on the batch as well instead of only waiting for it
+    takeTasks(lck);
+    workDone.wait(lck, [this]() {
+        return finishedTasks == taskCount;
+    });
+    currentTask = nullptr;
+    currentInvoker = nullptr;
+}
+
+size_t WorkerPool::getWorkerCount() const
+{
+    return threads.size();
+}
+
+void WorkerPool::takeTasks(std::unique_lock<std::mutex> &lck)
+{
+    while (nextTask < taskCount)
+    {
+        const size_t index = nextTask++;
+        const void *task = currentTask;
+        const Invoker invoker = currentInvoker;
+        lck.unlock();
+        invoker(task, index);
+        lck.lock();
+        if (++finishedTasks == taskCount)
+        {
+            workDone.notify_all();
+        }
+    }
+}
+
+void WorkerPool::work()
+{
+    uint64_t seenGeneration = 0;
+    std::unique_lock<std::mutex> lck(poolMutex);
+    while (true)
+    {
+        workAvailable.wait(lck, [&]() {
+            return stopping || generation != seenGeneration;
+        });
+        if (stopping)
+        {
+            return;
+        }
+        seenGeneration = generation;
+        takeTasks(lck);
+    }
+}
@@ -0,0 +1,63 @@
+#ifndef WORKER_POOL_HPP
+#define WORKER_POOL_HPP
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Small pool of threads that are started once and wait for work, so running tasks in parallel every frame does not
+// pay for starting threads
+class WorkerPool {
+    public:
+        explicit WorkerPool(size_t workers);
+        ~WorkerPool();
+
+        WorkerPool(const WorkerPool &) = delete;
+        WorkerPool &operator=(const WorkerPool &) = delete;
+
+        // Calls task(0) to task(count - 1) on the workers and on the calling thread, and returns once all calls
+        // have returned. Only one thread may call run at a time. The task is called through a pointer instead of
+        // being wrapped in a std::function, which would allocate for lambdas with more than two captures
+        template <typename Task>
+        void run(size_t count, const Task &task)
+        {
+            runBatch(count, &task, &invoke<Task>);
+        }
+
+        size_t getWorkerCount() const;
+
+    private:
+        using Invoker = void (*)(const void *task, size_t index);
+
+        template <typename Task>
+        static void invoke(const void *task, size_t index)
+        {
+            (*static_cast<const Task *>(task))(index);
+        }
+
+        void runBatch(size_t count, const void *task, Invoker invoker);
+
+        void work();
+
+        // Takes the next task of the current batch until none is left, returns with the lock held
+        void takeTasks(std::unique_lock<std::mutex> &lck);
+
+        std::vector<std::thread> threads;
+        std::mutex poolMutex;
+        std::condition_variable workAvailable;
+        std::condition_variable workDone;
+
+        // Current batch, a new batch increments the generation
+        const void *currentTask;
+        Invoker currentInvoker;
+        size_t taskCount;
+        size_t nextTask;
+        size_t finishedTasks;
+        uint64_t generation;
+        bool stopping;
+};
+
+#endif // WORKER_POOL_HPP
@@ -1,6 +1,7 @@
-import pandas as pd
-from matplotlib import pyplot as plt
+import os
 import sys
+from matplotlib import pyplot as plt
+from result_log import load_results
 
 def display_chart():
     # Set the plot size and layout
@@ -74,6 +75,12 @@ def compare_values():
     print("Percentage: ", round((valid/data_points)*100, 2), "%")
 
 
+def load_recording_results(name):
+    # The binary result log of the recording when there is one, its CSV output otherwise
+    path = f'../recordings/{name}{sys.argv[1]}'
+    return load_results(path + '.bin' if os.path.exists(path + '.bin') else path + '.csv')
+
+
 def main():
     # compare_values()
     display_chart()
@@ -82,9 +89,9 @@ def main():
 if __name__ == '__main__':
     try:
         # Read the .csv file or handle the exception if it doesn't exist
-        df_original = pd.read_csv(f'../recordings/original{sys.argv[1]}.csv', sep=';')
-        df_current = pd.read_csv(f'../recordings/current{sys.argv[1]}.csv', sep=';')
-        df_previous = pd.read_csv(f'../recordings/previous{sys.argv[1]}.csv', sep=';')
+        df_original = load_recording_results('original')
+        df_current = load_recording_results('current')
+        df_previous = load_recording_results('previous')
         main()
     except FileNotFoundError:
         print("File not found.")
\ No newline at end of file
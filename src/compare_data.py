@@ -1,5 +1,6 @@
-import pandas as pd
+import sys
 from matplotlib import pyplot as plt
+from result_log import load_results
 
 def display_chart():
     # Set the plot size and layout
@@ -78,8 +79,8 @@ def main():
 
 if __name__ == '__main__':
     try:
-        # Read the .csv file or handle the exception if it deosn't exist
-        df_current = pd.read_csv("src/current.csv", sep=';')
+        # Read the .csv file or the binary result log (.bin) or handle the exception if it deosn't exist
+        df_current = load_results(sys.argv[1] if len(sys.argv) > 1 else "src/current.csv")
         main()
     except FileNotFoundError:
         print("File not found.")
\ No newline at end of file
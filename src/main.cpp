@@ -25,86 +25,133 @@
 #include <opencv2/highgui/highgui.hpp>
 #include <opencv2/imgproc/imgproc.hpp>
 
-// Include fstream & iostream
+// Include iostream
 #include <iostream>
-#include <fstream>
 
-// Include queue library
-#include <queue>
+// Include chrono for measuring how long the shared memory is locked
+#include <chrono>
+
+// Include the threads and the output formatting for evaluating recordings in parallel
+#include <algorithm>
+#include <atomic>
+#include <iomanip>
+#include <sstream>
+#include <thread>
+
+// Include the signal handling for writing the pending output lines on Ctrl-C
+#include <csignal>
 
 // Include ImageDenoiser header file
 #include "ImageDenoiser.hpp"
 
-// Define min and max steering angles (+/-24% of max/min original groundSteering angles)
-#define MAX_STEERING 0.22107488
-#define MIN_STEERING -0.22107488
+// Include DurationStats header file
+#include "DurationStats.hpp"
+
+// Include FrameIngestor header file
+#include "FrameIngestor.hpp"
+
+// Include ConeDetector header file
+#include "ConeDetector.hpp"
 
-// Lower bound for detecting blue cones
-cv::Scalar blueLow = cv::Scalar(109, 68, 42);
-// Upper bound for detecting blue cones
-cv::Scalar blueHigh = cv::Scalar(135, 250, 120);
-// Lower bound for detecting yellow cones
-cv::Scalar yellowLow = cv::Scalar(11, 20, 128);
-// Upper bound for detecting yellow cones
-cv::Scalar yellowHigh = cv::Scalar(54, 198, 232);
+// Include WorkerPool header file
+#include "WorkerPool.hpp"
 
-// Blue threshold
-int blueThreshold = 30;
-// Blue max value
-int blueMaxValue = 255;
+// Include StagePipeline header file
+#include "StagePipeline.hpp"
 
-// Yellow threshold
-int yellowThreshold = 30;
-// Yellow max value
-int yellowMaxValue = 255;
+// Include SteeringEstimator header file
+#include "SteeringEstimator.hpp"
 
-// Size of the frame delay queue
-int queueSize = 2;
+// Include ResultWriter header file
+#include "ResultWriter.hpp"
 
-// Queue to delay our output by 2 frames if the car is moving forward
-std::queue<double> steeringQueue;       // Store original groundSteering angles
-std::queue<std::time_t> timestampQueue; // Store frame timestamps
+// Include RecordingReader header file
+#include "RecordingReader.hpp"
 
-int queueCounter = 0; // To count the first elements
+// Include RecordingEvaluator header file
+#include "RecordingEvaluator.hpp"
+
+// HSV bounds for detecting blue and yellow cones, and the threshold and max value for denoising their masks
+ConeColorSettings colorSettings;
+
+// Set by the trackbars when one of the HSV bounds has been changed
+bool colorRangesChanged = true;
+
+// Guards the HSV bounds, the thresholds and colorRangesChanged, the trackbars change them on the display thread while
+// the pipeline reads them on the classification thread
+std::mutex trackbarMutex;
+
+// Ends the frame loops on SIGINT and SIGTERM through the flag of cluon's own handler, which also stops the OD4 session.
+// The handler is reset by the first signal, so a second one ends the program while it still waits for a frame.
+static void onStopSignal(int)
+{
+    cluon::TerminateHandler::instance().isTerminated.store(true);
+}
+
+static bool isStopRequested()
+{
+    return cluon::TerminateHandler::instance().isTerminated.load();
+}
+
+// Everything that is computed for one frame, the pipeline keeps one of these per frame in flight
+struct FrameState {
+    cv::Mat image{};
+    cv::Mat imageROI{};
+    std::pair<bool, cluon::data::TimeStamp> timeStamp{};
+    cv::Mat maskBlue{};
+    cv::Mat maskYellow{};
+    cv::Mat processedBlue{};
+    cv::Mat processedYellow{};
+    std::vector<cv::Rect> boxesBlue{};
+    std::vector<cv::Rect> boxesYellow{};
+    SteeringResult steering{};
+};
 
 // Callback function used as a debug menu when detecting blue cones
 static void onBlueTrackbar(int value, void *userdata)
 {
     int trackbarIndex = reinterpret_cast<intptr_t>(userdata);
+    std::lock_guard<std::mutex> lck(trackbarMutex);
 
     switch (trackbarIndex)
     {
     case 0:
         // Hue Low
-        blueLow[0] = value;
+        colorSettings.blueLow[0] = value;
+        colorRangesChanged = true;
         break;
     case 1:
         // Hue High
-        blueHigh[0] = value;
+        colorSettings.blueHigh[0] = value;
+        colorRangesChanged = true;
         break;
     case 2:
         // Saturation Low
-        blueLow[1] = value;
+        colorSettings.blueLow[1] = value;
+        colorRangesChanged = true;
         break;
     case 3:
         // Saturation High
-        blueHigh[1] = value;
+        colorSettings.blueHigh[1] = value;
+        colorRangesChanged = true;
         break;
     case 4:
         // Value Low
-        blueLow[2] = value;
+        colorSettings.blueLow[2] = value;
+        colorRangesChanged = true;
         break;
     case 5:
         // Value High
-        blueHigh[2] = value;
+        colorSettings.blueHigh[2] = value;
+        colorRangesChanged = true;
         break;
     case 6:
         // Threshold
-        blueThreshold = value;
+        colorSettings.blueThreshold = value;
         break;
     case 7:
         // Max value
-        blueMaxValue = value;
+        colorSettings.blueMaxValue = value;
         break;
     default:
         break;
@@ -115,40 +162,47 @@ static void onBlueTrackbar(int value, void *userdata)
 static void onYellowTrackbar(int value, void *userdata)
 {
     int trackbarIndex = reinterpret_cast<intptr_t>(userdata);
+    std::lock_guard<std::mutex> lck(trackbarMutex);
 
     switch (trackbarIndex)
     {
     case 0:
         // Hue Low
-        yellowLow[0] = value;
+        colorSettings.yellowLow[0] = value;
+        colorRangesChanged = true;
         break;
     case 1:
         // Hue High
-        yellowHigh[0] = value;
+        colorSettings.yellowHigh[0] = value;
+        colorRangesChanged = true;
         break;
     case 2:
         // Saturation Low
-        yellowLow[1] = value;
+        colorSettings.yellowLow[1] = value;
+        colorRangesChanged = true;
         break;
     case 3:
         // Saturation High
-        yellowHigh[1] = value;
+        colorSettings.yellowHigh[1] = value;
+        colorRangesChanged = true;
         break;
     case 4:
         // Value Low
-        yellowLow[2] = value;
+        colorSettings.yellowLow[2] = value;
+        colorRangesChanged = true;
         break;
     case 5:
         // Value High
-        yellowHigh[2] = value;
+        colorSettings.yellowHigh[2] = value;
+        colorRangesChanged = true;
         break;
     case 6:
         // Threshold
-        yellowThreshold = value;
+        colorSettings.yellowThreshold = value;
         break;
     case 7:
         // Max value
-        yellowMaxValue = value;
+        colorSettings.yellowMaxValue = value;
         break;
     default:
         break;
@@ -161,32 +215,247 @@ int32_t main(int32_t argc, char **argv)
 
     // Parse the command line parameters as we require the user to specify some mandatory information on startup.
     auto commandlineArguments = cluon::getCommandlineArguments(argc, argv);
-    if ((0 == commandlineArguments.count("cid")) ||
-        (0 == commandlineArguments.count("name")) ||
+    if ((((0 == commandlineArguments.count("cid")) ||
+          (0 == commandlineArguments.count("name"))) &&
+         (0 == commandlineArguments.count("rec")) &&
+         (0 == commandlineArguments.count("eval"))) ||
         (0 == commandlineArguments.count("width")) ||
         (0 == commandlineArguments.count("height")))
     {
         std::cerr << argv[0] << " attaches to a shared memory area containing an ARGB image." << std::endl;
-        std::cerr << "Usage:   " << argv[0] << " --cid=<OD4 session> --name=<name of shared memory area> [--verbose [--blue] [--yellow]] " << std::endl;
+        std::cerr << "Usage:   " << argv[0] << " (--cid=<OD4 session> --name=<name of shared memory area> | --rec=<file> | --eval=<file>[,<file>...]) --width=<width> --height=<height> [--verbose [--blue] [--yellow]] [--color=<fused|lut|opencv>] [--denoise=<fused|opencv|mask>] [--blobs=<runs|labels|bitmask|contours>] [--frame-access=<clone|roi|inplace>] [--ingest-thread] [--parallel] [--threads=<n>] [--pipeline] [--sensors=<latest|interpolate>] [--delay-frames=<n>] [--angular-divisor=<x>] [--output=<file>] [--result-log=<file>] [--frame-cache=<directory>] [--stats] [--check-allocations] " << std::endl;
         std::cerr << "         --cid:    CID of the OD4Session to send and receive messages" << std::endl;
         std::cerr << "         --name:   name of the shared memory area to attach" << std::endl;
+        std::cerr << "         --rec:    replay a recording as fast as possible instead, its h264 frames are decoded with OpenCV" << std::endl;
+        std::cerr << "         --eval:   replay the recordings in parallel on all cores without any output and print the accuracy of each and of all" << std::endl;
+        std::cerr << "                   recordings as compare_data.py computes it, and the frames per second" << std::endl;
         std::cerr << "         --width:  width of the frame" << std::endl;
         std::cerr << "         --height: height of the frame" << std::endl;
         std::cerr << "         --verbose: display the image on the screen" << std::endl;
         std::cerr << "         --blue: display a debugging window for detecting blue cones" << std::endl;
         std::cerr << "         --yellow: display a debugging window for detecting yellow cones" << std::endl;
+        std::cerr << "         --color:  cone color classification, 'fused' single-pass kernel (default), 'lut' 4 MiB lookup table or 'opencv' cvtColor + inRange" << std::endl;
+        std::cerr << "         --denoise: mask denoising, 'fused' single pass over strips of rows (default), 'opencv' one function per step" << std::endl;
+        std::cerr << "                   or 'mask' gray value test on the cleaned mask, which also keeps even mask values (compare with compare_data.py)" << std::endl;
+        std::cerr << "         --blobs:  cone blob detection, 'runs' labelling of the runs of every row (default), 'labels' labelling of every pixel, 'bitmask' on a mask with one bit per pixel or 'contours' cv::findContours" << std::endl;
+        std::cerr << "         --frame-access: 'clone' copies the whole frame (default with --verbose), 'roi' copies only the ROI (default)," << std::endl;
+        std::cerr << "                   'inplace' processes the ROI while the shared memory is locked and only copies it for --verbose" << std::endl;
+        std::cerr << "         --ingest-thread: copy frames out of the shared memory on a separate thread into a ring of buffers" << std::endl;
+        std::cerr << "         --parallel: run the blue and the yellow branch (denoising, blob detection, distances) at the same time, same as --threads=2" << std::endl;
+        std::cerr << "         --threads: threads for the color classification and the branches, both are split into one strip of rows per thread (default: 1)" << std::endl;
+        std::cerr << "         --pipeline: run ingestion, classification and denoising, blob detection and steering, and the output on one thread each, every step on a different frame" << std::endl;
+        std::cerr << "         --sensors: steering values of a frame, 'latest' received values with the output delayed by --delay-frames (default)" << std::endl;
+        std::cerr << "                   or 'interpolate' angular velocity at the sample timestamp of the frame without the delay, the ground steering stays the received one" << std::endl;
+        std::cerr << "         --delay-frames: frames by which the timestamp and ground steering of a line lag behind the output with --sensors=latest (default: 2)" << std::endl;
+        std::cerr << "         --angular-divisor: the angular velocity is divided by it and multiplied by 0.3 for the steering output (default: 86)" << std::endl;
+        std::cerr << "         --output: CSV file for the timestamp, ground steering and output of every frame (default: /tmp/output.csv)" << std::endl;
+        std::cerr << "         --result-log: also write the output lines to a binary columnar file, which src/result_log.py reads with numpy" << std::endl;
+        std::cerr << "         --frame-cache: directory of the decoded frames of the recordings of --rec and --eval, a recording is decoded into it" << std::endl;
+        std::cerr << "                   once and read from it as long as the recording does not change" << std::endl;
+        std::cerr << "         --check-allocations: exit with an error if a frame buffer is reallocated after the warm-up frames" << std::endl;
+        std::cerr << "         --stats:  print how long the shared memory is locked and the stages take per frame, and dropped and late frames with --ingest-thread" << std::endl;
         std::cerr << "Example: " << argv[0] << " --cid=253 --name=img --width=640 --height=480 --verbose --blue --yellow" << std::endl;
     }
     else
     {
         // Extract the values from the command line parameters
         const std::string NAME{commandlineArguments["name"]};
+        const std::string REC{commandlineArguments["rec"]};
+        const std::string FRAME_CACHE{commandlineArguments["frame-cache"]};
         const uint32_t WIDTH{static_cast<uint32_t>(std::stoi(commandlineArguments["width"]))};
         const uint32_t HEIGHT{static_cast<uint32_t>(std::stoi(commandlineArguments["height"]))};
         const bool VERBOSE{commandlineArguments.count("verbose") != 0};
         const bool BLUE{commandlineArguments.count("blue") != 0};
         const bool YELLOW{commandlineArguments.count("yellow") != 0};
 
+        const bool STATS{commandlineArguments.count("stats") != 0};
+
+        // Select how the pixels are taken from the shared memory; the whole frame is only needed to display it
+        FrameAccess frameAccess{VERBOSE ? FrameAccess::CLONE : FrameAccess::ROI};
+        if (commandlineArguments.count("frame-access") != 0)
+        {
+            const std::string access{commandlineArguments["frame-access"]};
+            if (access == "clone")
+            {
+                frameAccess = FrameAccess::CLONE;
+            }
+            else if (access == "roi")
+            {
+                frameAccess = FrameAccess::ROI;
+            }
+            else if (access == "inplace")
+            {
+                frameAccess = FrameAccess::INPLACE;
+            }
+            else
+            {
+                std::cerr << argv[0] << ": Unknown frame access '" << access << "'." << std::endl;
+                return retCode;
+            }
+        }
+
+        // The ingestion thread copies every frame, so it cannot be combined with processing inside the shared memory
+        const bool INGEST_THREAD{commandlineArguments.count("ingest-thread") != 0};
+        if (INGEST_THREAD && frameAccess == FrameAccess::INPLACE)
+        {
+            std::cerr << argv[0] << ": --ingest-thread requires --frame-access=clone or --frame-access=roi." << std::endl;
+            return retCode;
+        }
+
+        const bool CHECK_ALLOCATIONS{commandlineArguments.count("check-allocations") != 0};
+        const bool PARALLEL{commandlineArguments.count("parallel") != 0};
+        const int THREADS{(commandlineArguments.count("threads") != 0) ? std::stoi(commandlineArguments["threads"]) : (PARALLEL ? 2 : 1)};
+        if (THREADS < 1)
+        {
+            std::cerr << argv[0] << ": --threads requires at least 1 thread." << std::endl;
+            return retCode;
+        }
+
+        // A recording is decoded into our own buffers, there is no shared memory to process in place or to wait for
+        if (!REC.empty() && (INGEST_THREAD || frameAccess == FrameAccess::INPLACE))
+        {
+            std::cerr << argv[0] << ": --rec cannot be combined with --ingest-thread or --frame-access=inplace." << std::endl;
+            return retCode;
+        }
+
+        // Every thread of the pipeline copies the frame it works on, the workspace is not used. A recording passes its
+        // sensor values on the ingestion thread, which is several frames ahead of the steering, so the lines of a
+        // replay would depend on the timing of the threads.
+        const bool PIPELINE{commandlineArguments.count("pipeline") != 0};
+        if (PIPELINE && (INGEST_THREAD || CHECK_ALLOCATIONS || frameAccess == FrameAccess::INPLACE || !REC.empty()))
+        {
+            std::cerr << argv[0] << ": --pipeline cannot be combined with --ingest-thread, --check-allocations, --frame-access=inplace or --rec." << std::endl;
+            return retCode;
+        }
+
+        // Select whether the steering uses the latest sensor values or the values at the timestamp of the frame
+        bool interpolateSensors{false};
+        if (commandlineArguments.count("sensors") != 0)
+        {
+            const std::string sensors{commandlineArguments["sensors"]};
+            if (sensors == "interpolate")
+            {
+                interpolateSensors = true;
+            }
+            else if (sensors != "latest")
+            {
+                std::cerr << argv[0] << ": Unknown sensor mode '" << sensors << "'." << std::endl;
+                return retCode;
+            }
+        }
+
+        // Number of frames by which the output lines are delayed while the video plays forward
+        const int DELAY_FRAMES{(commandlineArguments.count("delay-frames") != 0) ? std::stoi(commandlineArguments["delay-frames"]) : 2};
+        if (DELAY_FRAMES < 0)
+        {
+            std::cerr << argv[0] << ": --delay-frames cannot be negative." << std::endl;
+            return retCode;
+        }
+
+        // Divisor of the angular velocity in the steering formula, the tune target searches for the best one
+        const double ANGULAR_DIVISOR{(commandlineArguments.count("angular-divisor") != 0) ? std::stod(commandlineArguments["angular-divisor"]) : 86};
+        if (!(ANGULAR_DIVISOR > 0))
+        {
+            std::cerr << argv[0] << ": --angular-divisor has to be positive." << std::endl;
+            return retCode;
+        }
+
+        // Select how the ROI is classified into cone colors, both modes produce identical masks
+        ConeColorStage::Mode colorMode{ConeColorStage::Mode::FUSED};
+        if ((commandlineArguments.count("color") != 0) && !ConeColorStage::parseMode(commandlineArguments["color"], colorMode))
+        {
+            std::cerr << argv[0] << ": Unknown color mode '" << commandlineArguments["color"] << "'." << std::endl;
+            return retCode;
+        }
+
+        // Select how the masks are denoised, 'fused' and 'opencv' produce identical images
+        ImageDenoiser::Mode denoiseMode{ImageDenoiser::Mode::FUSED};
+        if ((commandlineArguments.count("denoise") != 0) && !ImageDenoiser::parseMode(commandlineArguments["denoise"], denoiseMode))
+        {
+            std::cerr << argv[0] << ": Unknown denoise mode '" << commandlineArguments["denoise"] << "'." << std::endl;
+            return retCode;
+        }
+
+        // Select how the cone blobs are found, all modes find the same bounding boxes
+        BlobDetector::Mode blobMode{BlobDetector::Mode::RUNS};
+        if ((commandlineArguments.count("blobs") != 0) && !BlobDetector::parseMode(commandlineArguments["blobs"], blobMode))
+        {
+            std::cerr << argv[0] << ": Unknown blob mode '" << commandlineArguments["blobs"] << "'." << std::endl;
+            return retCode;
+        }
+
+        // Evaluate the recordings instead of processing frames for display, every recording is replayed on one thread
+        // with its own stages and the threads take the next recording when they are done
+        if (commandlineArguments.count("eval") != 0)
+        {
+            std::vector<std::string> recordings;
+            std::stringstream recordingList{commandlineArguments["eval"]};
+            std::string recordingPath;
+            while (std::getline(recordingList, recordingPath, ','))
+            {
+                if (!recordingPath.empty())
+                {
+                    recordings.push_back(recordingPath);
+                }
+            }
+
+            EvaluationSettings settings;
+            settings.width = WIDTH;
+            settings.height = HEIGHT;
+            settings.colorMode = colorMode;
+            settings.denoiseMode = denoiseMode;
+            settings.blobMode = blobMode;
+            settings.steering.delayFrames = static_cast<size_t>(DELAY_FRAMES);
+            settings.steering.interpolateSensors = interpolateSensors;
+            settings.steering.angularDivisor = ANGULAR_DIVISOR;
+            settings.frameCache = FRAME_CACHE;
+
+            std::vector<EvaluationResult> results(recordings.size());
+            std::atomic<size_t> nextRecording{0};
+            const size_t evaluatorCount = std::min<size_t>(recordings.size(), std::max(1u, std::thread::hardware_concurrency()));
+            const auto evaluationStart = std::chrono::steady_clock::now();
+            std::vector<std::thread> evaluators;
+            for (size_t i = 0; i < evaluatorCount; i++)
+            {
+                evaluators.emplace_back([&]() {
+                    for (size_t next = nextRecording++; next < recordings.size(); next = nextRecording++)
+                    {
+                        RecordingEvaluator evaluator{settings};
+                        results[next] = evaluator.evaluate(recordings[next]);
+                    }
+                });
+            }
+            for (std::thread &evaluator : evaluators)
+            {
+                evaluator.join();
+            }
+            const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - evaluationStart).count();
+
+            // Score of every recording, and of all lines of all recordings together
+            SteeringScore total;
+            size_t totalFrames = 0;
+            bool failed = false;
+            std::cout << std::fixed << std::setprecision(2);
+            for (const EvaluationResult &result : results)
+            {
+                if (!result.ok)
+                {
+                    std::cerr << argv[0] << ": Cannot evaluate '" << result.recording << "': " << result.error << "." << std::endl;
+                    failed = true;
+                    continue;
+                }
+                std::cout << result.recording << ": " << result.frames << " frames, " << result.score.getValid() << "/"
+                          << result.score.getDataPoints() << " valid, " << result.score.getPercentage() << " %, "
+                          << static_cast<double>(result.frames) / result.seconds << " frames/s" << std::endl;
+                total.merge(result.score);
+                totalFrames += result.frames;
+            }
+            std::cout << "Total: " << totalFrames << " frames, " << total.getValid() << "/" << total.getDataPoints() << " valid, "
+                      << total.getPercentage() << " %, " << static_cast<double>(totalFrames) / seconds << " frames/s on "
+                      << evaluatorCount << " threads" << std::endl;
+            return failed ? retCode : 0;
+        }
+
         // If the blue command argument is passed, we debug the blue detection
         if (VERBOSE && BLUE)
         {
@@ -194,35 +463,35 @@ int32_t main(int32_t argc, char **argv)
 
             // Create a section for editing the lower boundary for hue
             cv::createTrackbar("Hue - low", "Mask Blue", NULL, 255, onBlueTrackbar, reinterpret_cast<void *>(0));
-            cv::setTrackbarPos("Hue - low", "Mask Blue", static_cast<int>(blueLow[0]));
+            cv::setTrackbarPos("Hue - low", "Mask Blue", static_cast<int>(colorSettings.blueLow[0]));
 
             // Create a section for editing the upper boundary for hue
             cv::createTrackbar("Hue - high", "Mask Blue", NULL, 255, onBlueTrackbar, reinterpret_cast<void *>(1));
-            cv::setTrackbarPos("Hue - high", "Mask Blue", static_cast<int>(blueHigh[0]));
+            cv::setTrackbarPos("Hue - high", "Mask Blue", static_cast<int>(colorSettings.blueHigh[0]));
 
             // Create a section for editing the lower boundary for saturation
             cv::createTrackbar("Sat - low", "Mask Blue", NULL, 255, onBlueTrackbar, reinterpret_cast<void *>(2));
-            cv::setTrackbarPos("Sat - low", "Mask Blue", static_cast<int>(blueLow[1]));
+            cv::setTrackbarPos("Sat - low", "Mask Blue", static_cast<int>(colorSettings.blueLow[1]));
 
             // Create a section for editing the upper boundary for saturation
             cv::createTrackbar("Sat - high", "Mask Blue", NULL, 255, onBlueTrackbar, reinterpret_cast<void *>(3));
-            cv::setTrackbarPos("Sat - high", "Mask Blue", static_cast<int>(blueHigh[1]));
+            cv::setTrackbarPos("Sat - high", "Mask Blue", static_cast<int>(colorSettings.blueHigh[1]));
 
             // Create a section for editing the lower boundary for value
             cv::createTrackbar("Val - low", "Mask Blue", NULL, 255, onBlueTrackbar, reinterpret_cast<void *>(4));
-            cv::setTrackbarPos("Val - low", "Mask Blue", static_cast<int>(blueLow[2]));
+            cv::setTrackbarPos("Val - low", "Mask Blue", static_cast<int>(colorSettings.blueLow[2]));
 
             // Create a section for editing the upper boundary for value
             cv::createTrackbar("Val - high", "Mask Blue", NULL, 255, onBlueTrackbar, reinterpret_cast<void *>(5));
-            cv::setTrackbarPos("Val - high", "Mask Blue", static_cast<int>(blueHigh[2]));
+            cv::setTrackbarPos("Val - high", "Mask Blue", static_cast<int>(colorSettings.blueHigh[2]));
 
             cv::namedWindow("Processed Blue", cv::WINDOW_NORMAL);
 
             cv::createTrackbar("Threshold", "Processed Blue", NULL, 255, onBlueTrackbar, reinterpret_cast<void *>(6));
-            cv::setTrackbarPos("Threshold", "Processed Blue", blueThreshold);
+            cv::setTrackbarPos("Threshold", "Processed Blue", colorSettings.blueThreshold);
 
             cv::createTrackbar("Max Value", "Processed Blue", NULL, 255, onBlueTrackbar, reinterpret_cast<void *>(7));
-            cv::setTrackbarPos("Max Value", "Processed Blue", blueMaxValue);
+            cv::setTrackbarPos("Max Value", "Processed Blue", colorSettings.blueMaxValue);
         }
 
         // If the yellow command argument is passed, we debug the yellow detection
@@ -232,380 +501,549 @@ int32_t main(int32_t argc, char **argv)
 
             // Create a section for editing the lower boundary for hue
             cv::createTrackbar("Hue - low", "Mask Yellow", NULL, 255, onYellowTrackbar, reinterpret_cast<void *>(0));
-            cv::setTrackbarPos("Hue - low", "Mask Yellow", static_cast<int>(yellowLow[0]));
+            cv::setTrackbarPos("Hue - low", "Mask Yellow", static_cast<int>(colorSettings.yellowLow[0]));
 
             // Create a section for editing the upper boundary for hue
             cv::createTrackbar("Hue - high", "Mask Yellow", NULL, 255, onYellowTrackbar, reinterpret_cast<void *>(1));
-            cv::setTrackbarPos("Hue - high", "Mask Yellow", static_cast<int>(yellowHigh[0]));
+            cv::setTrackbarPos("Hue - high", "Mask Yellow", static_cast<int>(colorSettings.yellowHigh[0]));
 
             // Create a section for editing the lower boundary for saturation
             cv::createTrackbar("Sat - low", "Mask Yellow", NULL, 255, onYellowTrackbar, reinterpret_cast<void *>(2));
-            cv::setTrackbarPos("Sat - low", "Mask Yellow", static_cast<int>(yellowLow[1]));
+            cv::setTrackbarPos("Sat - low", "Mask Yellow", static_cast<int>(colorSettings.yellowLow[1]));
 
             // Create a section for editing the upper boundary for saturation
             cv::createTrackbar("Sat - high", "Mask Yellow", NULL, 255, onYellowTrackbar, reinterpret_cast<void *>(3));
-            cv::setTrackbarPos("Sat - high", "Mask Yellow", static_cast<int>(yellowHigh[1]));
+            cv::setTrackbarPos("Sat - high", "Mask Yellow", static_cast<int>(colorSettings.yellowHigh[1]));
 
             // Create a section for editing the lower boundary for value
             cv::createTrackbar("Val - low", "Mask Yellow", NULL, 255, onYellowTrackbar, reinterpret_cast<void *>(4));
-            cv::setTrackbarPos("Val - low", "Mask Yellow", static_cast<int>(yellowLow[2]));
+            cv::setTrackbarPos("Val - low", "Mask Yellow", static_cast<int>(colorSettings.yellowLow[2]));
 
             // Create a section for editing the upper boundary for value
             cv::createTrackbar("Val - high", "Mask Yellow", NULL, 255, onYellowTrackbar, reinterpret_cast<void *>(5));
-            cv::setTrackbarPos("Val - high", "Mask Yellow", static_cast<int>(yellowHigh[2]));
+            cv::setTrackbarPos("Val - high", "Mask Yellow", static_cast<int>(colorSettings.yellowHigh[2]));
 
             cv::namedWindow("Processed Yellow", cv::WINDOW_NORMAL);
 
             cv::createTrackbar("Threshold", "Processed Yellow", NULL, 255, onYellowTrackbar, reinterpret_cast<void *>(6));
-            cv::setTrackbarPos("Threshold", "Processed Yellow", yellowThreshold);
+            cv::setTrackbarPos("Threshold", "Processed Yellow", colorSettings.yellowThreshold);
 
             cv::createTrackbar("Max Value", "Processed Yellow", NULL, 255, onYellowTrackbar, reinterpret_cast<void *>(7));
-            cv::setTrackbarPos("Max Value", "Processed Yellow", yellowMaxValue);
+            cv::setTrackbarPos("Max Value", "Processed Yellow", colorSettings.yellowMaxValue);
         }
 
-        // Attach to the shared memory.
-        std::unique_ptr<cluon::SharedMemory> sharedMemory{new cluon::SharedMemory{NAME}};
-        if (sharedMemory && sharedMemory->valid())
+        // Attach to the shared memory, or open the recording.
+        std::unique_ptr<cluon::SharedMemory> sharedMemory{REC.empty() ? new cluon::SharedMemory{NAME} : nullptr};
+        std::unique_ptr<RecordingReader> recording{REC.empty() ? nullptr : new RecordingReader{REC, FRAME_CACHE}};
+        if ((sharedMemory && sharedMemory->valid()) || (recording && recording->open()))
         {
-            std::clog << argv[0] << ": Attached to shared memory '" << sharedMemory->name() << " (" << sharedMemory->size() << " bytes)." << std::endl;
+            std::unique_ptr<cluon::OD4Session> od4;
+            if (sharedMemory)
+            {
+                std::clog << argv[0] << ": Attached to shared memory '" << sharedMemory->name() << " (" << sharedMemory->size() << " bytes)." << std::endl;
 
-            // Interface to a running OpenDaVINCI session where network messages are exchanged.
-            // The instance od4 allows you to send and receive messages.
-            cluon::OD4Session od4{static_cast<uint16_t>(std::stoi(commandlineArguments["cid"]))};
+                // Interface to a running OpenDaVINCI session where network messages are exchanged.
+                // The instance od4 allows you to send and receive messages.
+                od4.reset(new cluon::OD4Session{static_cast<uint16_t>(std::stoi(commandlineArguments["cid"]))});
+            }
+            else
+            {
+                std::clog << argv[0] << ": Replaying " << recording->getFrameCount() << " frames of '" << REC << "'." << std::endl;
+            }
+            const std::string windowName{sharedMemory ? sharedMemory->name() : REC};
 
-            // Ground stering request
-            opendlv::proxy::GroundSteeringRequest gsr;
-            std::mutex gsrMutex;
-            auto onGroundSteeringRequest = [&gsr, &gsrMutex](cluon::data::Envelope &&env)
+            // Steering from the sensor values, which are written by the receiver thread of od4 and read by the thread
+            // that steers
+            SteeringEstimator steeringEstimator{static_cast<size_t>(DELAY_FRAMES), interpolateSensors};
+            steeringEstimator.setAngularDivisor(ANGULAR_DIVISOR);
+            auto onGroundSteeringRequest = [&steeringEstimator](cluon::data::Envelope &&env)
             {
                 // The envelope data structure provide further details, such as sampleTimePoint as shown in this test case:
                 // https://github.com/chrberger/libcluon/blob/master/libcluon/testsuites/TestEnvelopeConverter.cpp#L31-L40
-                std::lock_guard<std::mutex> lck(gsrMutex);
-                gsr = cluon::extractMessage<opendlv::proxy::GroundSteeringRequest>(std::move(env));
+                opendlv::proxy::GroundSteeringRequest request = cluon::extractMessage<opendlv::proxy::GroundSteeringRequest>(std::move(env));
+                steeringEstimator.addGroundSteering(request.groundSteering());
                 // std::cout << "lambda: groundSteering = " << gsr.groundSteering() << std::endl;
             };
 
-            od4.dataTrigger(opendlv::proxy::GroundSteeringRequest::ID(), onGroundSteeringRequest);
             // End of ground stering request
 
             // Angular Velocity Reading
-            opendlv::proxy::AngularVelocityReading angularVelocity;
-            std::mutex angularVelocityMutex;
-            auto onAngularVelocityReading = [&angularVelocity, &angularVelocityMutex](cluon::data::Envelope &&env)
+            auto onAngularVelocityReading = [&steeringEstimator](cluon::data::Envelope &&env)
             {
-                std::lock_guard<std::mutex> lck(angularVelocityMutex);
-                angularVelocity = cluon::extractMessage<opendlv::proxy::AngularVelocityReading>(std::move(env));
+                const int64_t sampleTimeStamp = cluon::time::toMicroseconds(env.sampleTimeStamp());
+                opendlv::proxy::AngularVelocityReading reading = cluon::extractMessage<opendlv::proxy::AngularVelocityReading>(std::move(env));
+                steeringEstimator.addAngularVelocity(sampleTimeStamp, reading.angularVelocityZ());
             };
 
-            od4.dataTrigger(opendlv::proxy::AngularVelocityReading::ID(), onAngularVelocityReading);
             // End of angular velocity reading
 
-            // Initialize fstream for storing frame by frame values for comparison
-            std::ofstream fout;
-            fout.open("/tmp/output.csv");
-            fout << "sampleTimeStamp;groundSteering;output" << std::endl;
-
-            // Previous timestamp
-            std::time_t previousTimeStamp = 0;
-            // Check if the car is going backwards or forwards
-            bool isForward = true;
-            // Counter for how many frames have passed
-            int frameCounter = 0;
-
-            // Endless loop; end the program by pressing Ctrl-C.
-            while (od4.isRunning())
+            // A recording passes its sensor envelopes to the callbacks itself, in their order between the frames
+            if (od4)
             {
-                // OpenCV data structure to hold an image.
-                cv::Mat outputImage;
-
-                // TimeStamp variable
-                std::time_t currentTimeStamp;
-                std::pair<bool, cluon::data::TimeStamp> timeStamp;
-
-                // Wait for a notification of a new frame.
-                sharedMemory->wait();
-
-                // Lock the shared memory.
-                sharedMemory->lock();
+                od4->dataTrigger(opendlv::proxy::GroundSteeringRequest::ID(), onGroundSteeringRequest);
+                od4->dataTrigger(opendlv::proxy::AngularVelocityReading::ID(), onAngularVelocityReading);
+            }
+            bool recordingFailed = false;
+            size_t replayedFrames = 0;
+            const auto replayStart = std::chrono::steady_clock::now();
+            auto readRecordedFrame = [&](cv::Mat &image, std::pair<bool, cluon::data::TimeStamp> &timeStamp)
+            {
+                cluon::data::Envelope envelope;
+                bool frameDecoded = false;
+                while (!frameDecoded)
                 {
-                    // Copy the pixels from the shared memory into our own data structure.
-                    cv::Mat wrapped(HEIGHT, WIDTH, CV_8UC4, sharedMemory->data());
-                    outputImage = wrapped.clone();
-
-                    // Add TimeStamp
-                    timeStamp = sharedMemory->getTimeStamp();
-
-                    if (timeStamp.first)
+                    if (!recording->next(envelope, image, frameDecoded))
                     {
-                        // return 0;
-                        // std::cout << "Timestamp detected" << std::endl;
-                        if (cluon::time::toMicroseconds(timeStamp.second) == previousTimeStamp)
+                        if (recording->hasFailed())
                         {
-                            return 0;
-                            break;
-                            // std::cout << "Duplicate timestamp detected!" << std::endl;
+                            std::cerr << argv[0] << ": The decoder does not return one image per h264 frame of '" << REC << "'." << std::endl;
+                            recordingFailed = true;
                         }
+                        return false;
+                    }
+                    if (envelope.dataType() == opendlv::proxy::GroundSteeringRequest::ID())
+                    {
+                        onGroundSteeringRequest(std::move(envelope));
+                    }
+                    else if (envelope.dataType() == opendlv::proxy::AngularVelocityReading::ID())
+                    {
+                        onAngularVelocityReading(std::move(envelope));
+                    }
+                }
+                if (image.cols != static_cast<int>(WIDTH) || image.rows != static_cast<int>(HEIGHT))
+                {
+                    std::cerr << argv[0] << ": The frames of '" << REC << "' are " << image.cols << "x" << image.rows << " pixels." << std::endl;
+                    recordingFailed = true;
+                    return false;
+                }
+                timeStamp = std::make_pair(true, envelope.sampleTimeStamp());
+                replayedFrames++;
+                return true;
+            };
+            auto finishReplay = [&]()
+            {
+                const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - replayStart).count();
+                std::clog << argv[0] << ": Replayed " << replayedFrames << " frames in " << seconds << " s." << std::endl;
+            };
+
+            // Storing frame by frame values for comparison, the lines are written to the console and the file on a
+            // separate thread
+            const std::string OUTPUT{(commandlineArguments.count("output") != 0) ? commandlineArguments["output"] : "/tmp/output.csv"};
+            ResultWriter resultWriter{OUTPUT, std::cout};
+            if (!resultWriter.isOpen())
+            {
+                std::cerr << argv[0] << ": Cannot create '" << OUTPUT << "'." << std::endl;
+                return retCode;
+            }
+            if ((commandlineArguments.count("result-log") != 0) && !resultWriter.createLog(commandlineArguments["result-log"]))
+            {
+                std::cerr << argv[0] << ": Cannot create '" << commandlineArguments["result-log"] << "'." << std::endl;
+                return retCode;
+            }
+            resultWriter.start();
+
+            // Without a handler Ctrl-C would end the program before the pending output lines are written. cluon
+            // installs its handler when the OD4 session is first checked, which would replace ours, so it is created
+            // first.
+            cluon::TerminateHandler::instance();
+            struct sigaction stopAction{};
+            stopAction.sa_handler = &onStopSignal;
+            stopAction.sa_flags = SA_RESETHAND;
+            ::sigaction(SIGINT, &stopAction, nullptr);
+            ::sigaction(SIGTERM, &stopAction, nullptr);
+
+            // Color classification, denoising and blob detection per cone color, with all image buffers of a frame
+            // allocated once and reused for every frame
+            ConeDetector coneDetector{colorMode, denoiseMode, blobMode};
+            coneDetector.allocate(WIDTH, HEIGHT, static_cast<size_t>(THREADS));
+            FrameWorkspace &workspace = coneDetector.getWorkspace();
+
+            // Region of interest (ROI) in the bottom part of the image, and the center bottom of the image
+            const cv::Rect roi = coneDetector.getRoi();
+            const cv::Point imageCenter = coneDetector.getImageCenter();
+
+            // The workers and this thread share the strips of the pixel stages and the branches, with a single thread
+            // the pool has no workers and everything runs here one step after the other
+            WorkerPool workerPool{static_cast<size_t>(THREADS) - 1};
+
+            // Classify the pixels of the region of interest and denoise both masks
+            auto classifyAndDenoise = [&](const cv::Mat &imageROI, cv::Mat &maskBlue, cv::Mat &maskYellow, cv::Mat &processedBlue, cv::Mat &processedYellow)
+            {
+                // Pass the HSV bounds to the color stage if they were changed using the trackbars, the trackbars are
+                // moved on the display thread which is not this thread in the pipeline
+                {
+                    std::lock_guard<std::mutex> lck(trackbarMutex);
+                    if (colorRangesChanged)
+                    {
+                        coneDetector.setColorRanges(colorSettings);
+                        colorRangesChanged = false;
                     }
+                    coneDetector.setThresholds(colorSettings);
                 }
-                // TODO: Here, you can add some code to check the sampleTimePoint when the current frame was captured.
-                sharedMemory->unlock();
+                coneDetector.classifyAndDenoise(imageROI, maskBlue, maskYellow, processedBlue, processedYellow, workerPool);
+            };
+
+            // Previous timestamp, a frame with the same timestamp is the end of the recording
+            std::time_t previousTimeStamp = 0;
 
-                // Variable for the center bottom of the image
-                cv::Point imageCenter = cv::Point(WIDTH / 2, HEIGHT);
+            // Compute the steering output of a frame and decide which line is written for it
+            auto steer = [&](const std::pair<bool, cluon::data::TimeStamp> &timeStamp)
+            {
+                const SteeringResult steering = steeringEstimator.estimate(timeStamp.first, timeStamp.first ? cluon::time::toMicroseconds(timeStamp.second) : 0);
+                previousTimeStamp = steering.currentTimeStamp;
+                return steering;
+            };
 
-                // Create a region of interest (ROI) to focus on the bottom part of the image
-                int roiHeight = outputImage.rows - 230;
-                cv::Rect roi(0, 230, outputImage.cols, roiHeight); // x, y, width, height
-                cv::Mat imageROI = outputImage(roi);
+            // Draw and display the results of a frame and write its output line
+            auto presentFrame = [&](const FrameState &frame)
+            {
+                // The overlays are only drawn when they are displayed, so frames without a window do not allocate
+                // for the overlay text
+                if (VERBOSE)
+                {
+                    cv::Mat outputImage = frame.image;
 
-                // Make a copy of the image
-                cv::Mat blueImage;
-                cv::Mat yellowImage;
+                    // Clear the overlays of the previous frame where the frame was not copied
+                    if (frameAccess == FrameAccess::ROI || frameAccess == FrameAccess::INPLACE)
+                    {
+                        outputImage(cv::Rect(0, 0, roi.width, roi.y)).setTo(cv::Scalar::all(0));
+                    }
 
-                // Change the original image into HSV
-                cv::cvtColor(imageROI, blueImage, cv::COLOR_BGR2HSV);
-                cv::cvtColor(imageROI, yellowImage, cv::COLOR_BGR2HSV);
+                    // Draw the cones found by the branches on the output image
+                    for (const cv::Rect &rect : frame.boxesBlue)
+                    {
+                        cv::Point center = (rect.tl() + rect.br()) / 2; // Start point
+                        cv::line(outputImage, center, imageCenter, cv::Scalar(0, 255, 0), 3);
+                        cv::rectangle(outputImage, rect.tl(), rect.br(), cv::Scalar(255, 0, 0), 2);
+                    }
+                    for (const cv::Rect &rect : frame.boxesYellow)
+                    {
+                        cv::Point center = (rect.tl() + rect.br()) / 2;
+                        cv::line(outputImage, center, imageCenter, cv::Scalar(0, 255, 0), 3);
+                        cv::rectangle(outputImage, rect.tl(), rect.br(), cv::Scalar(0, 255, 255), 2);
+                    }
 
-                // Create masked images
-                cv::Mat maskBlue;
-                cv::Mat maskYellow;
+                    const SteeringResult &steering = frame.steering;
 
-                // Get pixels that are in range for blue cones
-                cv::inRange(blueImage, blueLow, blueHigh, maskBlue);
-                cv::inRange(yellowImage, yellowLow, yellowHigh, maskYellow);
+                    // Add overlay for current date and time in UTC format
+                    cluon::data::TimeStamp now = cluon::time::now();
 
-                // Create processed images
-                cv::Mat processedBlue;
-                cv::Mat processedYellow;
+                    std::time_t currentTimeSec = cluon::time::toMicroseconds(now) / 1000000; // Convert microseconds to seconds
+                    std::tm *gmtime = std::gmtime(&currentTimeSec);                          // Convert time_t to tm as UTC time
 
-                // Denoise processed images
-                ImageDenoiser::denoiseImage(imageROI, maskBlue, processedBlue, blueThreshold, blueMaxValue);
-                ImageDenoiser::denoiseImage(imageROI, maskYellow, processedYellow, yellowThreshold, yellowMaxValue);
+                    // OVERLAY METADATA
+                    cv::putText(outputImage, "Group 18", cv::Point(200, 30), cv::FONT_HERSHEY_SIMPLEX, 0.8, cv::Scalar(36, 0, 201), 1);
 
-                // Initialize an array of contours
-                std::vector<std::vector<cv::Point>> contoursBlue;
-                std::vector<std::vector<cv::Point>> contoursYellow;
+                    std::stringstream metadataStream;
+                    metadataStream << "Now:" << std::put_time(gmtime, "%Y-%m-%dT%H:%M:%SZ") << "; ts:" << std::to_string(steering.currentTimeStamp) << "; ";
+                    std::string overlayMetadata = metadataStream.str();
 
-                // Find contours from the mask
-                cv::findContours(processedBlue, contoursBlue, cv::RETR_EXTERNAL, cv::CHAIN_APPROX_SIMPLE);
-                cv::findContours(processedYellow, contoursYellow, cv::RETR_EXTERNAL, cv::CHAIN_APPROX_SIMPLE);
+                    cv::putText(outputImage, overlayMetadata, cv::Point(10, 60), cv::FONT_HERSHEY_SIMPLEX, 0.6, cv::Scalar(36, 0, 201), 1);
 
-                // Declare variables to keep track of the average distance to the left part and right part of the track
-                double averageDistanceLeft = 0;
-                double averageDistanceRight = 0;
+                    // OVERLAY GROUND
+                    std::stringstream groundStream;
+                    groundStream << "Ground Steering: " << steering.ground;
+                    std::string overlayGround = groundStream.str();
+                    cv::putText(outputImage, overlayGround, cv::Point(10, 130), cv::FONT_HERSHEY_SIMPLEX, 0.6, cv::Scalar(36, 0, 201), 1);
 
-                // Iterate through the blue contours
-                for (size_t i = 0; i < contoursBlue.size(); i++)
-                {
-                    // Create a rectangle out of the vectors
-                    cv::Rect rect = cv::boundingRect(contoursBlue[i]);
+                    // OVERLAY ANGULAR VELOCITY
+                    std::stringstream angularStream;
+                    angularStream << "Angular velocity: " << steering.angular << " [Z - Axis]";
+                    std::string overlayAngular = angularStream.str();
+                    cv::putText(outputImage, overlayAngular, cv::Point(10, 100), cv::FONT_HERSHEY_SIMPLEX, 0.6, cv::Scalar(36, 0, 201), 1);
 
-                    // Adjust the rectangle to the ROI
-                    rect.y += 230;
+                    // Display the original image and the ROI image
+                    cv::imshow(windowName.c_str(), outputImage);
+                    cv::imshow("ROI", frame.imageROI);
 
-                    // Check if the rectangle is not really small
-                    if (rect.area() > 100)
+                    // If the blue flag is set, display the blue mask and the processed blue image, as well as sliders to adjust HSV values
+                    if (BLUE)
                     {
-                        // Draw the rectangle on the output image
-                        cv::Point center = (rect.tl() + rect.br()) / 2; // Start point
-                        cv::line(outputImage, center, imageCenter, cv::Scalar(0, 255, 0), 3);
-                        cv::rectangle(outputImage, rect.tl(), rect.br(), cv::Scalar(255, 0, 0), 2);
+                        cv::imshow("Mask Blue", frame.maskBlue);
+                        cv::imshow("Processed Blue", frame.processedBlue);
+                    }
 
-                        // Add the distance from the car to the center of a cone
-                        averageDistanceLeft += cv::norm(imageCenter - center);
+                    // If the yellow flag is set, display the yellow mask and the processed yellow image, as well as sliders to adjust HSV values
+                    if (YELLOW)
+                    {
+                        cv::imshow("Mask Yellow", frame.maskYellow);
+                        cv::imshow("Processed Yellow", frame.processedYellow);
                     }
+
+                    cv::waitKey(1);
                 }
 
-                // Divide by the number of blue cones to get the average distance
-                if (contoursBlue.size() != 0)
+                // Output to the console and the csv file
+                const SteeringResult &steering = frame.steering;
+                if (steering.hasLine)
                 {
-                    averageDistanceLeft /= contoursBlue.size();
+                    ResultLine line;
+                    line.timestamp = steering.lineTimeStamp;
+                    line.ground = steering.lineGround;
+                    line.output = steering.output;
+                    resultWriter.write(line);
                 }
-                else
+            };
+
+            // Every step runs on its own thread and works on a different frame at the same time
+            if (PIPELINE)
+            {
+                // One frame per stage and one more that waits in front of each stage but the first one
+                const size_t slotCount = 7;
+                std::vector<FrameState> frames(slotCount);
+                for (FrameState &frame : frames)
                 {
-                    averageDistanceLeft = 0;
+                    frame.image = cv::Mat::zeros(static_cast<int>(HEIGHT), static_cast<int>(WIDTH), CV_8UC4);
+                    frame.imageROI = frame.image(roi);
+                    frame.maskBlue.create(roi.size(), CV_8UC1);
+                    frame.maskYellow.create(roi.size(), CV_8UC1);
+                    frame.processedBlue.create(roi.size(), CV_8UC1);
+                    frame.processedYellow.create(roi.size(), CV_8UC1);
                 }
 
-                // Iterate through the yellow contours
-                for (size_t i = 0; i < contoursYellow.size(); i++)
-                {
-                    // Create a rectangle out of the vectors
-                    cv::Rect rect = cv::boundingRect(contoursYellow[i]);
+                // The workers of workerPool are busy with the pixel stages, the branches get their own pool
+                WorkerPool blobPool{(THREADS > 1) ? 1u : 0u};
+                std::time_t previousIngestedTimeStamp = 0;
+                size_t presentedFrames = 0;
 
-                    // Adjust the rectangle to the ROI
-                    rect.y += 230;
+                StagePipeline pipeline{slotCount};
+                pipeline.setSource("ingest", [&](size_t slot) {
+                    FrameState &frame = frames[slot];
 
-                    // Check if the rectangle is not really small
-                    if (rect.area() > 100 && rect.y < 450 && (rect.x > 390 || rect.x < 340))
+                    // Wait for a notification of a new frame.
+                    sharedMemory->wait();
+                    if (isStopRequested() || !od4->isRunning())
                     {
-                        // Draw the rectangle on the output image
-                        cv::Point center = (rect.tl() + rect.br()) / 2;
-                        cv::line(outputImage, center, imageCenter, cv::Scalar(0, 255, 0), 3);
-                        cv::rectangle(outputImage, rect.tl(), rect.br(), cv::Scalar(0, 255, 255), 2);
-
-                        // Add the distance from the car to the center of a cone
-                        averageDistanceRight += cv::norm(imageCenter - center);
+                        return false;
                     }
-                }
 
-                // Divide by the number of yellow cones to get the average distance
-                if (contoursYellow.size() != 0)
-                {
-                    averageDistanceRight /= contoursYellow.size();
-                }
-                else
-                {
-                    averageDistanceRight = 0;
-                }
-
-                if (timeStamp.first)
-                {
-                    currentTimeStamp = cluon::time::toMicroseconds(timeStamp.second);
-                }
+                    sharedMemory->lock();
+                    {
+                        cv::Mat wrapped(HEIGHT, WIDTH, CV_8UC4, sharedMemory->data());
+                        if (frameAccess == FrameAccess::CLONE)
+                        {
+                            wrapped.copyTo(frame.image);
+                        }
+                        else
+                        {
+                            wrapped(roi).copyTo(frame.imageROI);
+                        }
+                        frame.timeStamp = sharedMemory->getTimeStamp();
+                    }
+                    sharedMemory->unlock();
 
-                // Check if the video is played forwards or backwards
-                // After frame 2, we determine the direction and we proceed with the rest of the steps
-                // We assume that it's going forward at first
-                if (frameCounter < 1)
-                {
-                    frameCounter++;
-                    previousTimeStamp = currentTimeStamp;
-                }
-                else if (frameCounter == 1)
-                {
-                    if (previousTimeStamp < currentTimeStamp)
+                    // The recording is over once the same frame is delivered again
+                    if (frame.timeStamp.first)
                     {
-                        isForward = true;
+                        const std::time_t ingestedTimeStamp = cluon::time::toMicroseconds(frame.timeStamp.second);
+                        if (ingestedTimeStamp == previousIngestedTimeStamp)
+                        {
+                            return false;
+                        }
+                        previousIngestedTimeStamp = ingestedTimeStamp;
                     }
-                    else
+                    return true;
+                });
+                pipeline.addStage("classify/denoise", [&](size_t slot) {
+                    FrameState &frame = frames[slot];
+                    classifyAndDenoise(frame.imageROI, frame.maskBlue, frame.maskYellow, frame.processedBlue, frame.processedYellow);
+                });
+                pipeline.addStage("blobs/steering", [&](size_t slot) {
+                    FrameState &frame = frames[slot];
+                    coneDetector.findCones(frame.processedBlue, frame.processedYellow, blobPool, frame.boxesBlue, frame.boxesYellow);
+                    frame.steering = steer(frame.timeStamp);
+                });
+                pipeline.addStage("overlay/output", [&](size_t slot) {
+                    presentFrame(frames[slot]);
+
+                    // Report the time per stage and the queues every 100 frames
+                    if (STATS && ++presentedFrames % 100 == 0)
                     {
-                        isForward = false;
+                        pipeline.printStats(std::clog);
+                        std::clog << std::endl;
                     }
-                }
-
-                float ground;   // Original GroundSteeringRequest we want to match
-                double angular; // AngularVelocity gotten from sensor data
-
-                // If you want to access the latest received ground steering, don't forget to lock the mutex:
-                {
-                    std::lock_guard<std::mutex> lck(gsrMutex);
-                    ground = gsr.groundSteering();
-                }
+                });
+                pipeline.run();
 
-                // Angular velocity data
-                {
-                    std::lock_guard<std::mutex> lck(angularVelocityMutex);
-                    angular = angularVelocity.angularVelocityZ();
-                }
-
-                // Add overlay for current date and time in UTC format
-                cluon::data::TimeStamp now = cluon::time::now();
+                resultWriter.stop();
+                return 0;
+            }
 
-                std::time_t currentTimeSec = cluon::time::toMicroseconds(now) / 1000000; // Convert microseconds to seconds
-                std::tm *gmtime = std::gmtime(&currentTimeSec);                          // Convert time_t to tm as UTC time
+            // How long the shared memory stays locked per frame, the h264 producer cannot write the next frame meanwhile
+            DurationStats lockStats{"shared memory lock held"};
 
-                // OVERLAY METADATA
-                cv::putText(outputImage, "Group 18", cv::Point(200, 30), cv::FONT_HERSHEY_SIMPLEX, 0.8, cv::Scalar(36, 0, 201), 1);
+            // OpenCV data structure to hold the image that is drawn on and displayed.
+            cv::Mat outputImage;
 
-                std::stringstream metadataStream;
-                metadataStream << "Now:" << std::put_time(gmtime, "%Y-%m-%dT%H:%M:%SZ") << "; ts:" << std::to_string(currentTimeStamp) << "; ";
-                std::string overlayMetadata = metadataStream.str();
+            // Optionally copy the frames out of the shared memory on a separate thread
+            std::unique_ptr<FrameIngestor> ingestor;
+            if (INGEST_THREAD)
+            {
+                ingestor.reset(new FrameIngestor{*sharedMemory, WIDTH, HEIGHT, roi, frameAccess});
+                ingestor->start();
+            }
+            int framesSinceStats = 0;
+            int warmUpFrames = 0;
 
-                cv::putText(outputImage, overlayMetadata, cv::Point(10, 60), cv::FONT_HERSHEY_SIMPLEX, 0.6, cv::Scalar(36, 0, 201), 1);
+            // Results of the current frame, its images are the buffers of the workspace
+            FrameState current;
 
-                // OVERLAY GROUND
-                std::stringstream groundStream;
-                groundStream << "Ground Steering: " << ground;
-                std::string overlayGround = groundStream.str();
-                cv::putText(outputImage, overlayGround, cv::Point(10, 130), cv::FONT_HERSHEY_SIMPLEX, 0.6, cv::Scalar(36, 0, 201), 1);
+            // Endless loop; end the program by pressing Ctrl-C, which writes the pending lines before it ends.
+            while (!isStopRequested() && (!od4 || od4->isRunning()))
+            {
+                // Part of the frame that is processed
+                cv::Mat imageROI;
 
-                // OVERLAY ANGULAR VELOCITY
-                std::stringstream angularStream;
-                angularStream << "Angular velocity: " << angular << " [Z - Axis]";
-                std::string overlayAngular = angularStream.str();
-                cv::putText(outputImage, overlayAngular, cv::Point(10, 100), cv::FONT_HERSHEY_SIMPLEX, 0.6, cv::Scalar(36, 0, 201), 1);
+                std::pair<bool, cluon::data::TimeStamp> timeStamp;
 
-                // Display image on your screen.
-                // If the verbose flag is set, display the original image and the ROI image
-                if (VERBOSE)
+                if (ingestor)
                 {
-                    cv::imshow(sharedMemory->name().c_str(), outputImage);
-                    cv::imshow("ROI", imageROI);
-
-                    // If the blue flag is set, display the blue mask and the processed blue image, as well as sliders to adjust HSV values
-                    if (BLUE)
+                    // Take the next frame that the ingestion thread copied out of the shared memory
+                    IngestedFrame *frame = ingestor->acquire();
+                    if (frame == nullptr)
                     {
-                        cv::imshow("Mask Blue", maskBlue);
-                        cv::imshow("Processed Blue", processedBlue);
+                        return 0;
                     }
+                    outputImage = frame->image;
+                    imageROI = outputImage(roi);
+                    timeStamp = std::make_pair(frame->hasTimeStamp, cluon::time::fromMicroseconds(frame->sampleTimeStamp));
 
-                    // If the yellow flag is set, display the yellow mask and the processed yellow image, as well as sliders to adjust HSV values
-                    if (YELLOW)
+                    // Report the ingestion counters every 100 frames
+                    if (STATS && ++framesSinceStats == 100)
                     {
-                        cv::imshow("Mask Yellow", maskYellow);
-                        cv::imshow("Processed Yellow", processedYellow);
+                        ingestor->printStats(std::clog);
+                        std::clog << std::endl;
+                        framesSinceStats = 0;
                     }
-
-                    cv::waitKey(1);
                 }
-
-                // Divide the angular velocity by approximately 100 and multiply by 0.3
-                // The minimum and maximum values for angularVelocityZ are -101.2573 and 111.0229
-                // The values are different than exactly 100, so we divide by 100 -(-1+11) = 90
-                // However, after playing around with that value, we found that 86 has the best accuracy
-                double output = (angular / 86) * 0.3;
-
-                // Clip the output ground steering angle
-                if (output > MAX_STEERING)
-                    output = MAX_STEERING;
-                else if (output < MIN_STEERING)
-                    output = MIN_STEERING;
-
-                // If the video is playing forward, we delay the output by 2 frames
-                // If the video is playing backwards, we output the values immediately
-                if (isForward == true)
+                else if (recording)
                 {
-                    // Push the ground steering angle and the timestamp to the queue
-                    steeringQueue.push(ground);
-                    timestampQueue.push(currentTimeStamp);
-
-                    // Increment the queue counter to delay the first 2 frames
-                    if (queueCounter < queueSize)
+                    // Decode the next frame of the recording into our own data structure.
+                    outputImage = workspace.frame;
+                    if (!readRecordedFrame(outputImage, timeStamp))
                     {
-                        queueCounter++;
+                        break;
                     }
-                    else
+                    imageROI = outputImage(roi);
+                }
+                else
+                {
+                    // Wait for a notification of a new frame.
+                    sharedMemory->wait();
+
+                    // Lock the shared memory.
+                    auto lockStart = std::chrono::steady_clock::now();
+                    sharedMemory->lock();
                     {
-                        if (steeringQueue.empty())
+                        cv::Mat wrapped(HEIGHT, WIDTH, CV_8UC4, sharedMemory->data());
+                        outputImage = workspace.frame;
+                        if (frameAccess == FrameAccess::CLONE)
                         {
-                            // Output to the console
-                            std::cout << "group_18;" << std::to_string(currentTimeStamp) << ";" << output << std::endl;
-                            // Output to the csv file
-                            fout << std::to_string(currentTimeStamp) << ";" << ground << ";" << output << std::endl;
+                            // Copy the pixels from the shared memory into our own data structure.
+                            wrapped.copyTo(outputImage);
+                            imageROI = outputImage(roi);
+                        }
+                        else if (frameAccess == FrameAccess::ROI)
+                        {
+                            // Only overlays are drawn outside of the ROI, so the rest of the frame is not copied
+                            wrapped(roi).copyTo(outputImage(roi));
+                            imageROI = outputImage(roi);
                         }
                         else
                         {
-                            // Output to the console
-                            std::cout << "group_18;" << std::to_string(timestampQueue.front()) << ";" << output << std::endl;
-                            // Output to the csv file
-                            fout << std::to_string(timestampQueue.front()) << ";" << steeringQueue.front() << ";" << output << std::endl;
-                            // Pop the first element from the queue to make space for the next frame
-                            timestampQueue.pop();
-                            steeringQueue.pop();
+                            // Nothing is copied, the pixel stages run on the shared memory while it is locked
+                            imageROI = wrapped(roi);
+                            classifyAndDenoise(imageROI, workspace.maskBlue, workspace.maskYellow, workspace.processedBlue, workspace.processedYellow);
+
+                            // The ROI is displayed after the unlock, when the producer may already write the next
+                            // frame, so it is copied for the window
+                            if (VERBOSE)
+                            {
+                                imageROI.copyTo(outputImage(roi));
+                            }
+                            imageROI = outputImage(roi);
                         }
+
+                        // Add TimeStamp
+                        timeStamp = sharedMemory->getTimeStamp();
+
+                        if (timeStamp.first)
+                        {
+                            // return 0;
+                            // std::cout << "Timestamp detected" << std::endl;
+                            if (cluon::time::toMicroseconds(timeStamp.second) == previousTimeStamp)
+                            {
+                                return 0;
+                                break;
+                                // std::cout << "Duplicate timestamp detected!" << std::endl;
+                            }
+                        }
+                    }
+                    // TODO: Here, you can add some code to check the sampleTimePoint when the current frame was captured.
+                    sharedMemory->unlock();
+                    lockStats.add(std::chrono::steady_clock::now() - lockStart);
+
+                    // Report the lock hold time every 100 frames
+                    if (STATS && lockStats.getCount() == 100)
+                    {
+                        lockStats.print(std::clog);
+                        std::clog << std::endl;
+                        lockStats.reset();
                     }
+
                 }
-                else
+
+                if (frameAccess != FrameAccess::INPLACE)
+                {
+                    classifyAndDenoise(imageROI, workspace.maskBlue, workspace.maskYellow, workspace.processedBlue, workspace.processedYellow);
+                }
+                coneDetector.findCones(workspace.processedBlue, workspace.processedYellow, workerPool, current.boxesBlue, current.boxesYellow);
+
+                // Report the time of the color stage, of each branch and of the steps of both branches every 100
+                // frames, the slower branch is the critical path when they run in parallel
+                if (STATS && coneDetector.getFrameCount() == 100)
                 {
-                    // Output to the console
-                    std::cout << "group_18;" << std::to_string(currentTimeStamp) << ";" << output << std::endl;
-                    // Output to the csv file
-                    fout << std::to_string(currentTimeStamp) << ";" << ground << ";" << output << std::endl;
+                    coneDetector.printStats(std::clog);
+                    std::clog << std::endl;
                 }
-                // Update the previous timestamp variable
-                previousTimeStamp = currentTimeStamp;
+
+                // Test hook: after the warm-up frames, processing a frame must not reallocate any buffer of the workspace
+                if (CHECK_ALLOCATIONS)
+                {
+                    if (++warmUpFrames == 2)
+                    {
+                        workspace.markWarm();
+                    }
+                    else if (workspace.countReallocations() != 0)
+                    {
+                        std::cerr << argv[0] << ": " << workspace.countReallocations() << " workspace buffers were reallocated after the warm-up." << std::endl;
+                        return retCode;
+                    }
+                }
+
+                current.image = outputImage;
+                current.imageROI = imageROI;
+                current.maskBlue = workspace.maskBlue;
+                current.maskYellow = workspace.maskYellow;
+                current.processedBlue = workspace.processedBlue;
+                current.processedYellow = workspace.processedYellow;
+                current.steering = steer(timeStamp);
+                presentFrame(current);
             }
-            fout.close();
+            resultWriter.stop();
+            if (recording)
+            {
+                finishReplay();
+                if (recordingFailed)
+                {
+                    return retCode;
+                }
+            }
+        }
+        else if (recording)
+        {
+            std::cerr << argv[0] << ": Cannot decode the h264 frames of '" << REC << "'." << std::endl;
+            return retCode;
         }
         retCode = 0;
     }
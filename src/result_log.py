@@ -0,0 +1,66 @@
+import numpy as np
+import pandas as pd
+
+# Layout of the binary result log, see ResultLog.hpp
+MAGIC = b'CPSRLOG\0'
+VERSION = 2
+HEADER_SIZE = 16
+TRAILER_SIZE = 24
+BLOCK_HEADER_SIZE = 8
+ROW_SIZE = 16
+
+
+def block_size(rows):
+    return BLOCK_HEADER_SIZE + rows * ROW_SIZE
+
+
+def read_blocks(data):
+    # Without a trailer the blocks are walked by their row counts, a block that was cut off is left out
+    blocks = []
+    offset = HEADER_SIZE
+    while offset + BLOCK_HEADER_SIZE <= len(data):
+        rows = int(np.frombuffer(data, dtype='<u8', count=1, offset=offset)[0])
+        if rows == 0 or offset + block_size(rows) > len(data):
+            break
+        blocks.append((offset, rows))
+        offset += block_size(rows)
+    return blocks
+
+
+def read_result_log(path):
+    # Map the file and take the columns of every block without parsing any text
+    data = np.memmap(path, dtype=np.uint8, mode='r')
+    if len(data) < HEADER_SIZE or bytes(data[:8]) != MAGIC:
+        raise ValueError(f'{path} is not a result log')
+    if int(np.frombuffer(data, dtype='<u4', count=1, offset=8)[0]) != VERSION:
+        raise ValueError(f'{path} has an unsupported version')
+
+    if len(data) >= HEADER_SIZE + TRAILER_SIZE and bytes(data[-8:]) == MAGIC:
+        block_count, index_offset = np.frombuffer(data, dtype='<u8', count=2, offset=len(data) - TRAILER_SIZE)
+        index = np.frombuffer(data, dtype='<u8', count=2 * int(block_count), offset=int(index_offset)).reshape(-1, 2)
+        blocks = [(int(offset), int(rows)) for offset, rows in index]
+    else:
+        blocks = read_blocks(data)
+
+    timestamps, ground, output = [], [], []
+    for offset, rows in blocks:
+        offset += BLOCK_HEADER_SIZE
+        timestamps.append(np.frombuffer(data, dtype='<i8', count=rows, offset=offset))
+        ground.append(np.frombuffer(data, dtype='<f4', count=rows, offset=offset + 8 * rows))
+        output.append(np.frombuffer(data, dtype='<f4', count=rows, offset=offset + 12 * rows))
+
+    def column(parts, dtype):
+        return np.concatenate(parts) if parts else np.empty(0, dtype=dtype)
+
+    return pd.DataFrame({
+        'sampleTimeStamp': column(timestamps, '<i8'),
+        'groundSteering': column(ground, '<f4'),
+        'output': column(output, '<f4'),
+    })
+
+
+def load_results(path):
+    # Result logs are read directly, everything else is read as the CSV output
+    if path.endswith('.bin'):
+        return read_result_log(path)
+    return pd.read_csv(path, sep=';')